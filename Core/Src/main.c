@@ -23,6 +23,7 @@
 #include "i2c.h"
 #include "iwdg.h"
 #include "spi.h"
+#include "tim.h"
 #include "usart.h"
 #include "gpio.h"
 
@@ -34,6 +35,9 @@
 #include "lra_control.h"
 #include "tca9548a.h"
 #include "fsr.h"
+#include "spi_queue.h"
+#include "telemetry.h"
+#include "scheduler.h"
 
 /* USER CODE END Includes */
 
@@ -44,6 +48,15 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
+// Scheduler tasks: period (ms), deadline (ms) and priority (0 is the highest)
+#define TASK_HAPTICS_PERIOD         1
+#define TASK_HAPTICS_DEADLINE       1
+#define TASK_HAPTICS_PRIORITY       0
+#define TASK_ACQUISITION_PRIORITY   1
+#define TASK_TELEMETRY_PRIORITY     2
+#define TASK_HOUSEKEEPING_PERIOD    100 // Well below the 400 ms IWDG timeout
+#define TASK_HOUSEKEEPING_DEADLINE  100
+#define TASK_HOUSEKEEPING_PRIORITY  3
 
 /* USER CODE END PD */
 
@@ -55,13 +68,19 @@
 /* Private variables ---------------------------------------------------------*/
 
 /* USER CODE BEGIN PV */
-__IO uint32_t data[19] = {0};
+int32_t samples[ADS1256_CHANNEL_NUM] = {0}; // The last frame finished by the ADS1256 acquisition engine
+uint8_t samples_ready = 0; // samples holds a frame not sent yet
+uint32_t haptics_tick = 0; // The HAL tick of the last haptics task run
 
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 /* USER CODE BEGIN PFP */
+static void Task_Haptics(void);
+static void Task_Acquisition(void);
+static void Task_Telemetry(void);
+static void Task_Housekeeping(void);
 
 /* USER CODE END PFP */
 
@@ -79,7 +98,6 @@ int main(void)
 
   /* USER CODE BEGIN 1 */
   uint8_t i = 0;
-  uint16_t checksum = 0;
 
   /* USER CODE END 1 */
 
@@ -107,28 +125,40 @@ int main(void)
   MX_USART1_UART_Init();
   MX_IWDG_Init();
   MX_ADC_Init();
+  MX_TIM14_Init();
+  MX_TIM3_Init();
+  MX_TIM2_Init();
   /* USER CODE BEGIN 2 */
+  HAL_TIM_Base_Start(&htim2); // The free-running microsecond timebase of the frame timestamps
   dbh_LRA_Control_Init(); // Initialize the LRA controller
-  dbh_ADS1256_Init(0); // Initialize the ADS1256
-  dbh_ADS1256_Init(1); // Initialize the ADS1256
-  // dbh_ADS1256_Init(2); // Initialize the ADS1256
-
-  dbh_TCA9548A_Init(); // Initialize the TCA9548A
-
-  for (i = 0; i < 5; i++)
+  dbh_SPIQueue_Init(); // Hand SPI1 over to the DMA transaction queue
+  for (i = 0; i < ADS1256_DEVICE_NUM; i++)
   {
-    dbh_TCA9548A_SelectChannel(i+3); // Select the first channel on the TCA9548A
-    dbh_DRV2605L_Init(); // Initialize the DRV2605L
+    dbh_ADS1256_Init(i); // Initialize the ADS1256
   }
 
+  dbh_ADS1256_StartScan(); // Start the DRDY interrupt driven acquisition, overlapped until the host selects the simultaneous mode
+
   //ADC initialization
 	HAL_ADCEx_Calibration_Start(&hadc);
 	HAL_ADC_Start_DMA(&hadc, (uint32_t*)&_u16ADC_Value, 50);
 	HAL_ADC_Start(&hadc);
 
+  // The TCA9548A and DRV2605L are brought up by dbh_DRV2605L_BringUp() in the main loop, so the frames are streamed meanwhile
+  dbh_Telemetry_SetReady(TELEMETRY_STATUS_SENSORS_READY | TELEMETRY_STATUS_HAPTICS_CALIBRATING);
+
+  HAL_TIM_Base_Start_IT(&htim14); // Fire the scheduled haptic events every 1 ms
+
   HAL_GPIO_WritePin(LED1_GPIO_Port, LED1_Pin, GPIO_PIN_SET); // Turn on the LED1
   HAL_GPIO_WritePin(LED2_GPIO_Port, LED2_Pin, GPIO_PIN_SET); // Turn on the LED2
 
+  // The main loop is a cooperative scheduler, the SysTick interrupt only posts its ticks
+  haptics_tick = HAL_GetTick();
+  dbh_Scheduler_AddTask(Task_Haptics, TASK_HAPTICS_PERIOD, TASK_HAPTICS_DEADLINE, TASK_HAPTICS_PRIORITY);
+  dbh_Scheduler_AddTask(Task_Acquisition, SCHEDULER_POLL, 0, TASK_ACQUISITION_PRIORITY);
+  dbh_Scheduler_AddTask(Task_Telemetry, SCHEDULER_POLL, 0, TASK_TELEMETRY_PRIORITY);
+  dbh_Scheduler_AddTask(Task_Housekeeping, TASK_HOUSEKEEPING_PERIOD, TASK_HOUSEKEEPING_DEADLINE, TASK_HOUSEKEEPING_PRIORITY);
+
   /* USER CODE END 2 */
 
   /* Infinite loop */
@@ -138,48 +168,7 @@ int main(void)
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
-    // Haptics feedback control
-    // If the waveform number is between 1 and 123, play the waveform
-    for (i = 0; i < 5; i++)
-    {
-      dbh_TCA9548A_SelectChannel(i+3);
-
-      if (dbh_GetWaveNum(i) > 0 && dbh_GetWaveNum(i) < 124)
-      {
-        if (dbh_GetCounter(i) == 0)
-        {
-          dbh_ResetCounter(i);
-          dbh_DRV2605L_PlayWaveform(dbh_GetWaveNum(i));
-        }
-      }
-      // Else, stop the waveform
-      else
-      {
-        dbh_DRV2605L_StopWaveform();
-      }
-    }
-
-    // Read the data from the ADS1256
-    data[0] = 0x55AA;
-    data[1] = dbh_FSR_GetADCValue();
-    for (i = 1; i <= 16; i++)
-    {
-      // i = 0 - 7, for the first ADS1256
-      // i = 8 - 15, for the second ADS1256
-      dbh_ADS1256_SelectChannel((i-1)%8, i>8);
-      data[i+1] = dbh_ADS1256_ReadData(i>8);
-      // voltage[i] = (float)data[i] * 5.0 / 0x7FFFFF;
-      // voltage[i] = data[i] * 0.000000596;
-    }
-    // Calculate the checksum
-    checksum = 0;
-    for (i = 1; i <= 17; i++)
-    {
-      checksum += data[i];
-    }
-    data[18] = (checksum << 16) | dbh_GetTimestamp();
-
-    HAL_UART_Transmit(&huart1, (uint8_t *)data, 76, 1000); // Send the data over UART
+    dbh_Scheduler_Run(); // Never returns
   }
   /* USER CODE END 3 */
 }
@@ -234,6 +223,125 @@ void SystemClock_Config(void)
 }
 
 /* USER CODE BEGIN 4 */
+/**
+  * @brief  Execute the host commands and drive the haptics
+  * @retval None
+  *
+  * This task runs every 1 ms. While the haptics come up, it runs one bring-up step instead.
+  */
+static void Task_Haptics(void)
+{
+  uint8_t i = 0;
+  uint8_t stop_mask = 0;
+  uint8_t amplitude = 0;
+  uint32_t now = HAL_GetTick();
+
+  // Bring up the haptics one step per run, the commands received meanwhile are executed when it is done
+  if (dbh_DRV2605L_GetStage() != DRV2605L_STAGE_READY)
+  {
+    if (dbh_DRV2605L_BringUp() == DRV2605L_STAGE_READY)
+    {
+      dbh_Telemetry_SetReady(TELEMETRY_STATUS_SENSORS_READY | TELEMETRY_STATUS_HAPTICS_READY);
+    }
+  }
+
+  // The scheduled events update the same channel state from the TIM14 interrupt
+  // They are held back meanwhile, so they don't race the host commands and the decisions of this task
+  HAL_NVIC_DisableIRQ(TIM14_IRQn);
+
+  // Execute the host commands received since the last run
+  dbh_LRA_Control_Process();
+
+  // Haptics feedback control
+  // If the waveform number is between 1 and 123, play the waveform
+  // Only the register writes that change the state of a DRV2605L go onto the I2C bus
+  dbh_DecCounter(now - haptics_tick);
+  haptics_tick = now;
+  for (i = 0; i < DRV2605L_DEVICE_NUM && dbh_DRV2605L_GetStage() == DRV2605L_STAGE_READY; i++)
+  {
+    // In RTP mode, write the latest amplitude streamed by the host
+    if (dbh_IsRTP(i))
+    {
+      if (dbh_GetRTPUpdate(i, &amplitude) && dbh_DRV2605L_SetRTP(i, amplitude))
+      {
+        dbh_ClearRTPUpdate(i);
+      }
+    }
+    else if (dbh_GetWaveNum(i) > 0 && dbh_GetWaveNum(i) < 124)
+    {
+      if (dbh_GetCounter(i) == 0)
+      {
+        // A new command cancels the effect still playing, a repeat lets it finish
+        if (dbh_DRV2605L_PlayWaveform(i, dbh_GetWaveNum(i), dbh_IsPreempted(i))) // Queued on the I2C bus, retried next run if the device is busy
+        {
+          dbh_ResetCounter(i);
+          dbh_ClearPreempted(i);
+        }
+      }
+    }
+    // Else, stop the waveform
+    else
+    {
+      stop_mask |= 1 << i;
+    }
+  }
+  dbh_DRV2605L_StopAll(stop_mask); // Stop all idle fingers in one broadcast
+  HAL_NVIC_EnableIRQ(TIM14_IRQn);
+}
+
+/**
+  * @brief  Collect the frame finished by the ADS1256 acquisition engine, if any
+  * @retval None
+  */
+static void Task_Acquisition(void)
+{
+  if (!samples_ready && dbh_ADS1256_GetFrame(samples))
+  {
+    samples_ready = 1;
+  }
+}
+
+/**
+  * @brief  Send the collected frame to the host
+  * @retval None
+  */
+static void Task_Telemetry(void)
+{
+  if (samples_ready)
+  {
+    dbh_Telemetry_SendFrame(samples);
+    samples_ready = 0;
+  }
+}
+
+/**
+  * @brief  Refresh the IWDG and update the statistics
+  * @retval None
+  *
+  * The IWDG is refreshed from a task, so a task that hangs the scheduler resets the MCU.
+  */
+static void Task_Housekeeping(void)
+{
+  HAL_IWDG_Refresh(&hiwdg); // Refresh the IWDG
+  dbh_SPIQueue_TickStats(TASK_HOUSEKEEPING_PERIOD); // For the SPI throughput and CPU load figures
+  dbh_Telemetry_TickHousekeeping(TASK_HOUSEKEEPING_PERIOD); // Stream the timing histograms
+}
+/**
+  * @brief  Period elapsed callback in non blocking mode
+  * @param  htim: TIM handle
+  * @retval None
+  */
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+  if (htim->Instance == TIM14)
+  {
+    dbh_LRA_Control_TickEvents(); // Fire the scheduled haptic events that are due
+  }
+  else if (htim->Instance == TIM3)
+  {
+    dbh_ADS1256_TriggerScan(); // Start the next frame of the paced acquisition
+  }
+}
 
 /* USER CODE END 4 */
 
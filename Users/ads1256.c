@@ -8,25 +8,149 @@
   ******************************************************************************
   */
 
+
 #include "ads1256.h"
-#include "spi.h"
+#include "spi_queue.h"
+#include "tim.h"
+#include "delay.h"
+#include "profiler.h"
+
+#if ADS1256_DEVICE_NUM > ADS1256_DEVICE_MAX
+#error "ADS1256_DEVICE_NUM exceeds the devices on the board"
+#endif
+
+// The ADS1256 devices on the board, 0 for device 1, 1 for device 2, 2 for device 3
+static const ADS1256_DEVICE_TypeDef devices[ADS1256_DEVICE_MAX] = {
+    {ADS1256_DRDY_1_GPIO_Port, ADS1256_DRDY_1_Pin, SPI1_CS1_Pin, 0x00 | ADS1256_GAIN_1, ADS1256_DRATE_30000SPS},
+    {ADS1256_DRDY_2_GPIO_Port, ADS1256_DRDY_2_Pin, SPI1_CS2_Pin, 0x00 | ADS1256_GAIN_1, ADS1256_DRATE_30000SPS},
+    {ADS1256_DRDY_3_GPIO_Port, ADS1256_DRDY_3_Pin, SPI1_CS3_Pin, 0x00 | ADS1256_GAIN_1, ADS1256_DRATE_30000SPS},
+};
+
+// Read the DRDY pin for the specified device, non-zero while no conversion result is ready
+#define ADS1256_DRDY(x)  (devices[x].drdy_port->IDR & devices[x].drdy_pin)
+
+// The CS pin of the specified device, driven by the SPI queue through BSRR/BRR
+#define CS_PIN(x)        (devices[x].cs_pin)
+
+// The EXTI line of the DRDY pin for the specified device, the line number equals the pin number
+#define DRDY_LINE(x)     (devices[x].drdy_pin)
+
+// Unmask the DRDY interrupt of the specified device, dropping any edge that happened while it was masked
+#define DRDY_IT_ENABLE(x)  do { EXTI->PR = DRDY_LINE(x); EXTI->IMR |= DRDY_LINE(x); } while (0)
+
+// Mask the DRDY interrupt of the specified device, so the free-running conversions of an idle device cost no CPU time
+#define DRDY_IT_DISABLE(x) do { EXTI->IMR &= ~DRDY_LINE(x); } while (0)
+
+#define ADS1256_CYCLE_SIZE        9 // Bytes clocked in one multiplexer cycle: WREG MUX (3), SYNC, WAKEUP, RDATA, data (3)
+#define ADS1256_TRIGGER_ALL       ADS1256_DEVICE_NUM // The SPI queue trigger line set when the DRDY of every device went low
+
+// Segments of a register write: the whole WREG command in one go
+static const SPI_SEGMENT_TypeDef wreg_segments[] = {{3, 0}, {0, 0}};
+
+// Segments of a single command
+static const SPI_SEGMENT_TypeDef command_segments[] = {{1, 0}, {0, 0}};
+
+// Segments of a conversion restart: WREG MUX, SYNC and WAKEUP
+// The command-to-command delay is 4 * tCLKIN (t11), 24 * tCLKIN = 3.125us after SYNC
+static const SPI_SEGMENT_TypeDef start_segments[] = {{3, 0}, {1, 1}, {1, 4}, {0, 0}};
+
+// Segments of a held conversion restart: WREG MUX and SYNC, the conversion starts at the WAKEUP
+static const SPI_SEGMENT_TypeDef sync_segments[] = {{3, 0}, {1, 1}, {0, 0}};
+
+// Segments of the first WAKEUP after the SYNC commands, 24 * tCLKIN = 3.125us after the last SYNC
+static const SPI_SEGMENT_TypeDef wakeup_segments[] = {{1, 4}, {0, 0}};
+
+// Segments of a multiplexer cycle, the same as a conversion restart followed by RDATA and the data
+// The delay between RDATA and reading the data is at least 50 * tCLKIN = 6.5us (t6)
+static const SPI_SEGMENT_TypeDef cycle_segments[] = {{3, 0}, {1, 1}, {1, 4}, {1, 1}, {3, 7}, {0, 0}};
+
+// Segments of a data read: RDATA and the data
+static const SPI_SEGMENT_TypeDef read_segments[] = {{1, 0}, {3, 7}, {0, 0}};
+
+// The bytes of a multiplexer cycle, indexed by the channel to convert next
+static const uint8_t cycle_commands[8][ADS1256_CYCLE_SIZE] = {
+    {ADS1256_CMD_WREG | ADS1256_REG_MUX, 0x00, (0 << 4) | ADS1256_MUXN_AINCOM, ADS1256_CMD_SYNC, ADS1256_CMD_WAKEUP, ADS1256_CMD_RDATA, 0x00, 0x00, 0x00},
+    {ADS1256_CMD_WREG | ADS1256_REG_MUX, 0x00, (1 << 4) | ADS1256_MUXN_AINCOM, ADS1256_CMD_SYNC, ADS1256_CMD_WAKEUP, ADS1256_CMD_RDATA, 0x00, 0x00, 0x00},
+    {ADS1256_CMD_WREG | ADS1256_REG_MUX, 0x00, (2 << 4) | ADS1256_MUXN_AINCOM, ADS1256_CMD_SYNC, ADS1256_CMD_WAKEUP, ADS1256_CMD_RDATA, 0x00, 0x00, 0x00},
+    {ADS1256_CMD_WREG | ADS1256_REG_MUX, 0x00, (3 << 4) | ADS1256_MUXN_AINCOM, ADS1256_CMD_SYNC, ADS1256_CMD_WAKEUP, ADS1256_CMD_RDATA, 0x00, 0x00, 0x00},
+    {ADS1256_CMD_WREG | ADS1256_REG_MUX, 0x00, (4 << 4) | ADS1256_MUXN_AINCOM, ADS1256_CMD_SYNC, ADS1256_CMD_WAKEUP, ADS1256_CMD_RDATA, 0x00, 0x00, 0x00},
+    {ADS1256_CMD_WREG | ADS1256_REG_MUX, 0x00, (5 << 4) | ADS1256_MUXN_AINCOM, ADS1256_CMD_SYNC, ADS1256_CMD_WAKEUP, ADS1256_CMD_RDATA, 0x00, 0x00, 0x00},
+    {ADS1256_CMD_WREG | ADS1256_REG_MUX, 0x00, (6 << 4) | ADS1256_MUXN_AINCOM, ADS1256_CMD_SYNC, ADS1256_CMD_WAKEUP, ADS1256_CMD_RDATA, 0x00, 0x00, 0x00},
+    {ADS1256_CMD_WREG | ADS1256_REG_MUX, 0x00, (7 << 4) | ADS1256_MUXN_AINCOM, ADS1256_CMD_SYNC, ADS1256_CMD_WAKEUP, ADS1256_CMD_RDATA, 0x00, 0x00, 0x00},
+};
+
+SPI_TRANSACTION_TypeDef scan_xfer[ADS1256_CHANNEL_NUM]; // One multiplexer cycle per channel, a whole scan is queued at once
+uint8_t scan_raw[ADS1256_CHANNEL_NUM][ADS1256_CYCLE_SIZE] = {0}; // Filled by the DMA during a scan
+int32_t frame_buffer[ADS1256_CHANNEL_NUM] = {0}; // The last finished frame, handed over to the main loop
+__IO uint8_t scan_done = 0; // One bit per device that finished its channels in the current scan
+__IO uint8_t frame_ready = 0;
+
+__IO uint8_t scan_mode = ADS1256_MODE_OVERLAPPED; // The mode of the current scan
+__IO uint8_t scan_mode_request = ADS1256_MODE_OVERLAPPED; // The mode of the next scan
+SPI_TRANSACTION_TypeDef sync_xfer[ADS1256_DEVICE_NUM]; // Simultaneous-sample mode: MUX switch and SYNC on each device
+SPI_TRANSACTION_TypeDef wakeup_xfer[ADS1256_DEVICE_NUM]; // Simultaneous-sample mode: WAKEUP on each device, back to back
+SPI_TRANSACTION_TypeDef read_xfer[ADS1256_DEVICE_NUM]; // Simultaneous-sample mode: RDATA on each device
+uint8_t sync_raw[ADS1256_CYCLE_SIZE] = {0}; // The received bytes of the MUX switch, SYNC and WAKEUP, ignored
+__IO uint8_t sync_channel = 0; // Simultaneous-sample mode: the channel read in the current step
+__IO uint8_t drdy_ready = 0; // Simultaneous-sample mode: one bit per device whose DRDY went low
+__IO uint16_t frame_period = ADS1256_FRAME_PERIOD_FREE; // The frame period in us, paced by the TIM3 update interrupt
+__IO uint8_t scan_idle = 0; // Paced acquisition: the last scan is finished and the next one waits for TIM3
+__IO uint8_t scan_late = 0; // Paced acquisition: a TIM3 update came while the current scan was still running
+__IO uint32_t scan_start = 0; // The dbh_GetMicros() time when the current scan was queued
+uint32_t scan_cycles = 0; // The cycle count when the current scan was queued, for the profiler
+ADS1256_FRAME_INFO_TypeDef frame_info = {0}; // The timing of frame_buffer
+ADS1256_FRAME_INFO_TypeDef frame_info_copied = {0}; // The timing of the frame copied by the last dbh_ADS1256_GetFrame()
+
+/**
+  * @brief  Run a single CS frame on the ADS1256 and wait until it is finished
+  * @param  tx_data: the bytes to send
+  * @param  segments: the segments of the CS frame, terminated by a zero size
+  * @retval None
+  *
+  * Only used during initialization, before the scan is started.
+  */
+static void ADS1256_Transfer(const uint8_t *tx_data, const SPI_SEGMENT_TypeDef *segments, uint8_t device)
+{
+    uint8_t rx_data[ADS1256_CYCLE_SIZE] = {0};
+    SPI_TRANSACTION_TypeDef xfer = {0};
+
+    xfer.tx_data = tx_data;
+    xfer.rx_data = rx_data;
+    xfer.segments = segments;
+    xfer.cs_pins = CS_PIN(device);
+    xfer.trigger = SPI_QUEUE_NO_TRIGGER;
+
+    dbh_SPIQueue_Submit(&xfer);
+    dbh_SPIQueue_Wait(&xfer);
+}
 
-// Read the DRDY pin for the specified device, 0 for device 1, 1 for device 2, 2 for device 3
-#define ADS1256_DRDY(x)  ((x) == 2 ? HAL_GPIO_ReadPin(ADS1256_DRDY_3_GPIO_Port, ADS1256_DRDY_3_Pin) : \
-                         ((x) == 1 ? HAL_GPIO_ReadPin(ADS1256_DRDY_2_GPIO_Port, ADS1256_DRDY_2_Pin) : \
-                                     HAL_GPIO_ReadPin(ADS1256_DRDY_1_GPIO_Port, ADS1256_DRDY_1_Pin)))
+/**
+  * @brief  Convert the 3 bytes of conversion data to a signed value
+  * @param  rx_data: the conversion data, most significant byte first
+  * @retval the 24-bit conversion data, sign extended
+  */
+static int32_t ADS1256_ToInt32(const uint8_t *rx_data)
+{
+    int32_t result = 0;
+    uint32_t data = 0;
 
-// Set the CS pin low to select the device, 0 for device 1, 1 for device 2, 2 for device 3
-#define CS_LOW(x)        ((x) == 2 ? HAL_GPIO_WritePin(SPI1_CS3_GPIO_Port, SPI1_CS3_Pin, GPIO_PIN_RESET) : \
-                         ((x) == 1 ? HAL_GPIO_WritePin(SPI1_CS2_GPIO_Port, SPI1_CS2_Pin, GPIO_PIN_RESET) : \
-                                     HAL_GPIO_WritePin(SPI1_CS1_GPIO_Port, SPI1_CS1_Pin, GPIO_PIN_RESET)))
+    // Combine the 3 bytes of conversion data into a single 24-bit value
+    data = (rx_data[0] << 16) | (rx_data[1] << 8) | rx_data[2];
 
-// Set the CS pin high to release the device, 0 for device 1, 1 for device 2, 2 for device 3
-#define CS_HIGH(x)       ((x) == 2 ? HAL_GPIO_WritePin(SPI1_CS3_GPIO_Port, SPI1_CS3_Pin, GPIO_PIN_SET) : \
-                         ((x) == 1 ? HAL_GPIO_WritePin(SPI1_CS2_GPIO_Port, SPI1_CS2_Pin, GPIO_PIN_SET) : \
-                                     HAL_GPIO_WritePin(SPI1_CS1_GPIO_Port, SPI1_CS1_Pin, GPIO_PIN_SET)))
+    if (data & 0x800000) // If the most significant bit is set, the value is negative
+    {
+        // Do two's complement to get the negative value
+        data = ~data + 1;
+        data &= 0xFFFFFF; // Mask off the upper 8 bits
+        result = -data;
+    }
+    else // The value is positive
+    {
+        result = data;
+    }
 
-__IO HAL_StatusTypeDef status;
+    return result;
+}
 
 /**
   * @brief  Use WREG command to write to a single register on the ADS1256
@@ -43,10 +167,8 @@ void ADS1256_WREG(uint8_t reg, uint8_t data, uint8_t device)
     commands[1] = 0x00; // Send the number of registers to write minus one (0x00 for one register)
     commands[2] = data; // Send the data to write to the register
 
-    while (ADS1256_DRDY(device) == GPIO_PIN_SET); // Wait for DRDY to go low to indicate the device is ready
-    CS_LOW(device); // Select the current device
-    HAL_SPI_Transmit(&hspi1, commands, 3, 1000); // Send the write register command
-    CS_HIGH(device); // Release the current device
+    while (ADS1256_DRDY(device)); // Wait for DRDY to go low to indicate the device is ready
+    ADS1256_Transfer(commands, wreg_segments, device);
 }
 
 /**
@@ -57,16 +179,27 @@ void ADS1256_SelfCal(uint8_t device)
 {
     uint8_t command = ADS1256_CMD_SELFCAL;
 
-    while (ADS1256_DRDY(device) == GPIO_PIN_SET); // Wait for DRDY to go low to indicate the device is ready
-    CS_LOW(device); // Select the current device
-    HAL_SPI_Transmit(&hspi1, &command, 1, 1000); // Send the self-calibration command
-    while (ADS1256_DRDY(device) == GPIO_PIN_SET); // Wait for DRDY to go low to indicate the calibration is complete
-    CS_HIGH(device); // Release the current device
+    while (ADS1256_DRDY(device)); // Wait for DRDY to go low to indicate the device is ready
+    ADS1256_Transfer(&command, command_segments, device); // Send the self-calibration command
+    while (ADS1256_DRDY(device)); // Wait for DRDY to go low to indicate the calibration is complete
+}
+
+/**
+  * @brief  Write the MUX register and restart the conversion
+  * @param  channel: the channel to select (0-7), measured against AINCOM
+  * @retval None
+  */
+static void ADS1256_StartConversion(uint8_t channel, uint8_t device)
+{
+    // The first 5 bytes of a multiplexer cycle are WREG MUX, SYNC and WAKEUP
+    ADS1256_Transfer(cycle_commands[channel], start_segments, device);
 }
 
 /**
   * @brief  Initialize the ADS1256
   * @retval None
+  *
+  * dbh_SPIQueue_Init() must have been called before.
   */
 void dbh_ADS1256_Init(uint8_t device)
 {    
@@ -77,109 +210,417 @@ void dbh_ADS1256_Init(uint8_t device)
     // Bit 0:   0 - !DRDY (Read only, don't care)
     ADS1256_WREG(ADS1256_REG_STATUS, 0x06, device);    
 
-    // Set the A/D control register to 0x20 (0b 0010 0000)
+    // Set the A/D control register from the device table, 0x00 by default (0b 0000 0000)
     // Bit 7:   0 - Reserved, always 0 (Read only)
     // Bit 6-5: 00 - Clock out OFF
     // Bit 4-3: 00 - Sensor detect OFF
     // Bit 2-0: 000 - Programmable gain amplifier setting = 1
-    ADS1256_WREG(ADS1256_REG_ADCON, 0x00 | ADS1256_GAIN_1, device);
+    ADS1256_WREG(ADS1256_REG_ADCON, devices[device].adcon, device);
 
-    // Set the A/D data rate register to 30,000SPS
-    ADS1256_WREG(ADS1256_REG_DRATE, ADS1256_DRATE_30000SPS, device);
+    // Set the A/D data rate register from the device table, 30,000SPS by default
+    ADS1256_WREG(ADS1256_REG_DRATE, devices[device].drate, device);
 
     // Perform a self-calibration
     ADS1256_SelfCal(device);
 
-    // Set the input multiplexer register to AIN0 and AINCOM
-    dbh_ADS1256_SelectChannel(0, device);
+    // Set the input multiplexer register to AIN0 and AINCOM, the scan pipeline starts from this channel
+    while (ADS1256_DRDY(device)); // Wait for DRDY to go low to indicate the calibration is complete
+    ADS1256_StartConversion(0, device);
+}
+
+/**
+  * @brief  Queue the MUX switch of the current simultaneous-sample step
+  * @retval None
+  *
+  * Only the first device waits for the DRDY of every device, the others are queued by ADS1256_SyncStart().
+  */
+static void ADS1256_QueueSyncStep(void)
+{
+    uint8_t i = 0;
+
+    for (i = 0; i < ADS1256_DEVICE_NUM; i++)
+    {
+        sync_xfer[i].tx_data = cycle_commands[(sync_channel + 1) & 0x07]; // WREG MUX and SYNC of the next channel
+    }
+    dbh_SPIQueue_Submit(&sync_xfer[0]);
+}
+
+/**
+  * @brief  Queue a whole scan in the selected mode
+  * @retval None
+  *
+  * In ADS1256_MODE_OVERLAPPED, every multiplexer cycle waits for the DRDY trigger of its device. All
+  * devices convert at the same time and the queue serves whichever DRDY fires first, so one device
+  * settles while the other one is read.
+  * In ADS1256_MODE_SIMULTANEOUS, the scan is run step by step, see ADS1256_SyncCplt().
+  */
+static void ADS1256_QueueScan(void)
+{
+    uint8_t i = 0;
+
+    scan_done = 0;
+    scan_mode = scan_mode_request; // The mode only changes between frames
+    scan_start = dbh_GetMicros();
+    PROFILER_START(scan_cycles);
+
+    if (scan_mode == ADS1256_MODE_SIMULTANEOUS)
+    {
+        sync_channel = 0;
+        drdy_ready = 0;
+        dbh_SPIQueue_ClearTrigger(ADS1256_TRIGGER_ALL); // The first step waits for a fresh DRDY of every device
+        ADS1256_QueueSyncStep();
+    }
+    else
+    {
+        for (i = 0; i < ADS1256_CHANNEL_NUM; i++)
+        {
+            dbh_SPIQueue_Submit(&scan_xfer[i]);
+        }
+    }
+
+    for (i = 0; i < ADS1256_DEVICE_NUM; i++)
+    {
+        DRDY_IT_ENABLE(i);
+    }
+}
+
+/**
+  * @brief  Hand the finished frame over to the main loop and queue the next scan
+  * @retval None
+  *
+  * In the paced acquisition, the next scan is queued by dbh_ADS1256_TriggerScan() instead.
+  */
+static void ADS1256_FrameCplt(void)
+{
+    uint8_t i = 0;
+
+    PROFILER_STOP(PROFILER_STAGE_ADS_SCAN, scan_cycles);
+
+    // Bytes 6-8 of every cycle are the conversion data of the previous channel
+    for (i = 0; i < ADS1256_CHANNEL_NUM; i++)
+    {
+        frame_buffer[i] = ADS1256_ToInt32(&scan_raw[i][6]);
+    }
+    frame_info.timestamp = scan_start;
+    frame_info.sequence++;
+    frame_info.late = scan_late;
+    scan_late = 0;
+    frame_ready = 1;
+
+    if (frame_period == ADS1256_FRAME_PERIOD_FREE)
+    {
+        ADS1256_QueueScan(); // Start the next frame
+    }
+    else
+    {
+        scan_idle = 1; // Wait for the next TIM3 update
+    }
+}
+
+/**
+  * @brief  Multiplexer cycle complete callback
+  * @param  xfer: the finished transaction, one of scan_xfer
+  * @retval None
+  *
+  * This function is called by the SPI queue in interrupt context. When the last device finishes its
+  * channels, it hands the frame over and queues the next scan.
+  */
+static void ADS1256_CycleCplt(SPI_TRANSACTION_TypeDef *xfer)
+{
+    uint8_t slot = xfer - scan_xfer;
+    uint8_t device = slot / 8;
+
+    // A conversion with the old MUX setting may have finished while the SPI was busy,
+    // drop it so the next interrupt is the settled result of the new channel
+    EXTI->PR = DRDY_LINE(device);
+
+    if ((slot & 0x07) != 0x07) // More channels on this device
+    {
+        return;
+    }
+
+    // This device is done and already converting channel 0 of the next frame
+    DRDY_IT_DISABLE(device);
+    scan_done |= 1 << device;
+
+    if (scan_done != (1 << ADS1256_DEVICE_NUM) - 1) // Wait for the other devices
+    {
+        return;
+    }
+
+    ADS1256_FrameCplt();
+}
+
+/**
+  * @brief  MUX switch of the first device complete callback
+  * @param  xfer: the finished transaction, sync_xfer[0]
+  * @retval None
+  *
+  * A simultaneous-sample step starts when the DRDY of every device went low. The MUX switch and SYNC
+  * are sent to every device in its own CS frame, SYNC holds the device until its WAKEUP. The WAKEUP
+  * commands follow back to back, so the devices restart one WAKEUP frame apart, about 8 us at the
+  * 1.5 MHz SCLK. The sampling instants of a channel differ by this fixed offset between the devices.
+  * The commands are not broadcast with every CS low: the ADS1256 drives DOUT while its CS is low, so the
+  * devices would all drive MISO at once. The SYNC/PDWN pins are not wired to the MCU.
+  */
+static void ADS1256_SyncStart(SPI_TRANSACTION_TypeDef *xfer)
+{
+    uint8_t i = 0;
+
+    for (i = 1; i < ADS1256_DEVICE_NUM; i++)
+    {
+        dbh_SPIQueue_Submit(&sync_xfer[i]);
+    }
+
+    for (i = 0; i < ADS1256_DEVICE_NUM; i++)
+    {
+        dbh_SPIQueue_Submit(&wakeup_xfer[i]);
+    }
 }
 
 /**
-  * @brief  Select the specified channel on the ADS1256
-  * @param  channel: the channel to select (0-7)
+  * @brief  WAKEUP of the last device complete callback
+  * @param  xfer: the finished transaction, wakeup_xfer[ADS1256_DEVICE_NUM - 1]
   * @retval None
+  *
+  * The data registers still hold the result of the current channel, which is then read from the devices
+  * one after another.
   */
-void dbh_ADS1256_SelectChannel(uint8_t channel, uint8_t device)
+static void ADS1256_SyncCplt(SPI_TRANSACTION_TypeDef *xfer)
 {
-    uint8_t commands[2] = {0};
+    uint8_t i = 0;
 
-    // Build the command to select the specified channel
-    commands[0] = ADS1256_CMD_SYNC; // Send the SYNC command
-    commands[1] = ADS1256_CMD_WAKEUP; // Send the WAKEUP command
+    drdy_ready = 0;
 
-    if (channel < 8)
+    for (i = 0; i < ADS1256_DEVICE_NUM; i++)
     {
-        while (ADS1256_DRDY(device) == GPIO_PIN_SET); // Wait for DRDY to go low to indicate the device is ready
+        EXTI->PR = DRDY_LINE(i); // Drop the edges of the old MUX setting
 
-        // Set the input multiplexer register to the specified channel
-        switch (channel)
+        // RDATA and the data land in bytes 5-8 of the cycle buffer, as in the overlapped mode
+        read_xfer[i].rx_data = &scan_raw[i * 8 + sync_channel][5];
+        dbh_SPIQueue_Submit(&read_xfer[i]);
+    }
+}
+
+/**
+  * @brief  Simultaneous-sample read complete callback
+  * @param  xfer: the finished transaction, one of read_xfer
+  * @retval None
+  */
+static void ADS1256_ReadCplt(SPI_TRANSACTION_TypeDef *xfer)
+{
+    uint8_t i = 0;
+
+    if (xfer != &read_xfer[ADS1256_DEVICE_NUM - 1]) // More devices to read in this step
+    {
+        return;
+    }
+
+    sync_channel++;
+
+    if (sync_channel < 8)
+    {
+        ADS1256_QueueSyncStep();
+    }
+    else // All devices are already converting channel 0 of the next frame
+    {
+        for (i = 0; i < ADS1256_DEVICE_NUM; i++)
         {
-            case 0:
-                ADS1256_WREG(ADS1256_REG_MUX, ADS1256_MUXP_AIN0 | ADS1256_MUXN_AINCOM, device);
-                break;
-            case 1:
-                ADS1256_WREG(ADS1256_REG_MUX, ADS1256_MUXP_AIN1 | ADS1256_MUXN_AINCOM, device);
-                break;
-            case 2:
-                ADS1256_WREG(ADS1256_REG_MUX, ADS1256_MUXP_AIN2 | ADS1256_MUXN_AINCOM, device);
-                break;
-            case 3:
-                ADS1256_WREG(ADS1256_REG_MUX, ADS1256_MUXP_AIN3 | ADS1256_MUXN_AINCOM, device);
-                break;
-            case 4:
-                ADS1256_WREG(ADS1256_REG_MUX, ADS1256_MUXP_AIN4 | ADS1256_MUXN_AINCOM, device);
-                break;
-            case 5:
-                ADS1256_WREG(ADS1256_REG_MUX, ADS1256_MUXP_AIN5 | ADS1256_MUXN_AINCOM, device);
-                break;
-            case 6:
-                ADS1256_WREG(ADS1256_REG_MUX, ADS1256_MUXP_AIN6 | ADS1256_MUXN_AINCOM, device);
-                break;
-            case 7:
-                ADS1256_WREG(ADS1256_REG_MUX, ADS1256_MUXP_AIN7 | ADS1256_MUXN_AINCOM, device);
-                break;
+            DRDY_IT_DISABLE(i); // Until the next scan is queued, as in the overlapped mode
         }
+        ADS1256_FrameCplt();
+    }
+}
+
+/**
+  * @brief  Select the scan mode
+  * @param  mode: ADS1256_MODE_OVERLAPPED or ADS1256_MODE_SIMULTANEOUS
+  * @retval None
+  *
+  * The new mode takes effect at the next frame. In ADS1256_MODE_SIMULTANEOUS, the same channel of all
+  * devices is sampled within a few us, starting from the second frame after the switch, see ADS1256_SyncStart().
+  */
+void dbh_ADS1256_SetMode(uint8_t mode)
+{
+    scan_mode_request = mode;
+}
+
+/**
+  * @brief  Start the interrupt driven acquisition engine
+  * @retval None
+  *
+  * A whole scan, channels 0-7 on every device, is queued on the SPI as one multiplexer cycle per channel.
+  * Every DRDY falling edge releases the next cycle of its device, which the DMA clocks out while the CPU
+  * is free. The devices convert concurrently and share the bus in the order their DRDY fires.
+  * The cycle of channel n reads channel n and starts channel n+1, and the last one wraps around to
+  * channel 0, so each device is already converting channel 0 when its turn comes again.
+  * dbh_ADS1256_Init() must have been called for every device.
+  */
+void dbh_ADS1256_StartScan(void)
+{
+    uint8_t i = 0;
 
-        // Send the SYNC and WAKEUP command to synchronize the A/D conversion
-        CS_LOW(device); // Select the current device
-        HAL_SPI_Transmit(&hspi1, commands, 1, 1000); // Send the SYNC command
-        // The duration of the SYNC command and the WAKEUP command is at least 24 * tCLKIN, that is, 24 * 1 / 7.68MHz = 3.125us
-        HAL_SPI_Transmit(&hspi1, commands+1, 1, 1000); // Send the WAKEUP command
-        CS_HIGH(device); // Release the current device
+    for (i = 0; i < ADS1256_DEVICE_NUM; i++)
+    {
+        DRDY_IT_DISABLE(i);
+    }
+
+    for (i = 0; i < ADS1256_CHANNEL_NUM; i++)
+    {
+        scan_xfer[i].tx_data = cycle_commands[(i + 1) & 0x07];
+        scan_xfer[i].rx_data = scan_raw[i];
+        scan_xfer[i].segments = cycle_segments;
+        scan_xfer[i].callback = ADS1256_CycleCplt;
+        scan_xfer[i].cs_pins = CS_PIN(i / 8);
+        scan_xfer[i].trigger = i / 8; // The DRDY of the device
     }
+
+    for (i = 0; i < ADS1256_DEVICE_NUM; i++)
+    {
+        sync_xfer[i].rx_data = sync_raw;
+        sync_xfer[i].segments = sync_segments;
+        sync_xfer[i].callback = i == 0 ? ADS1256_SyncStart : NULL;
+        sync_xfer[i].cs_pins = CS_PIN(i);
+        sync_xfer[i].trigger = i == 0 ? ADS1256_TRIGGER_ALL : SPI_QUEUE_NO_TRIGGER; // The others are queued by ADS1256_SyncStart()
+
+        wakeup_xfer[i].tx_data = &cycle_commands[0][4]; // WAKEUP
+        wakeup_xfer[i].rx_data = sync_raw;
+        wakeup_xfer[i].segments = i == 0 ? wakeup_segments : command_segments; // Only the first one follows a SYNC on the bus
+        wakeup_xfer[i].callback = i == ADS1256_DEVICE_NUM - 1 ? ADS1256_SyncCplt : NULL;
+        wakeup_xfer[i].cs_pins = CS_PIN(i);
+        wakeup_xfer[i].trigger = SPI_QUEUE_NO_TRIGGER;
+
+        read_xfer[i].tx_data = &cycle_commands[0][5]; // RDATA followed by 3 dummy bytes
+        read_xfer[i].segments = read_segments;
+        read_xfer[i].callback = ADS1256_ReadCplt;
+        read_xfer[i].cs_pins = CS_PIN(i);
+        read_xfer[i].trigger = SPI_QUEUE_NO_TRIGGER; // Queued by ADS1256_SyncCplt() once the step started
+    }
+
+    ADS1256_QueueScan(); // Channel 0 was selected by dbh_ADS1256_Init()
 }
 
 /**
-  * @brief  Read the conversion data from the ADS1256
-  * @retval the 24-bit conversion data
+  * @brief  Copy the last finished frame
+  * @param  samples: buffer of ADS1256_CHANNEL_NUM entries to receive the conversion data
+  * @retval 1 if a new frame was copied, 0 if no frame finished since the last call
   */
-int32_t dbh_ADS1256_ReadData(uint8_t device)
+uint8_t dbh_ADS1256_GetFrame(int32_t *samples)
 {
-    int32_t result = 0;
-    uint32_t data = 0;
-    uint8_t rx_data[3] = {0};
-    uint8_t command = ADS1256_CMD_RDATA;
+    uint8_t i = 0;
+
+    if (!frame_ready)
+    {
+        return 0;
+    }
 
-    while (ADS1256_DRDY(device) == GPIO_PIN_SET); // Wait for DRDY to go low to indicate the device is ready
-    CS_LOW(device); // Select the current device
-    status = HAL_SPI_Transmit(&hspi1, &command, 1, 1000); // Send the RDATA command to read the conversion
-    status = HAL_SPI_Receive(&hspi1, rx_data, 3, 1000); // Read the conversion data
-    CS_HIGH(device); // Release the current device
+    __disable_irq(); // The SPI queue must not overwrite the frame while it is copied
+    for (i = 0; i < ADS1256_CHANNEL_NUM; i++)
+    {
+        samples[i] = frame_buffer[i];
+    }
+    frame_info_copied = frame_info;
+    frame_ready = 0;
+    __enable_irq();
 
-    // Combine the 3 bytes of conversion data into a single 24-bit value
-    data = (rx_data[0] << 16) | (rx_data[1] << 8) | rx_data[2];
+    return 1;
+}
 
-    if (data & 0x800000) // If the most significant bit is set, the value is negative
+/**
+  * @brief  Get the timing of the frame copied by the last dbh_ADS1256_GetFrame() call
+  * @retval the start timestamp, sequence number and late flag of the frame
+  *
+  * A gap in the sequence numbers is a frame dropped on the way to the host. A late frame is sent all
+  * the same, but the next scan waits for the next TIM3 update, so a frame slot is skipped instead of
+  * shifting the sampling grid.
+  */
+const ADS1256_FRAME_INFO_TypeDef *dbh_ADS1256_GetFrameInfo(void)
+{
+    return &frame_info_copied;
+}
+
+/**
+  * @brief  Select the frame period
+  * @param  period_us: the frame period in us, ADS1256_FRAME_PERIOD_FREE for a free-running scan
+  * @retval None
+  *
+  * In the paced acquisition, every TIM3 update starts a scan, so the frames are evenly spaced instead of
+  * following the scan time. TIM3 counts in us. dbh_ADS1256_StartScan() must have been called.
+  */
+void dbh_ADS1256_SetFramePeriod(uint16_t period_us)
+{
+    HAL_TIM_Base_Stop_IT(&htim3);
+
+    __disable_irq();
+    frame_period = period_us;
+    if (period_us == ADS1256_FRAME_PERIOD_FREE && scan_idle) // Nothing will trigger the waiting scan anymore
     {
-        // Do two's complement to get the negative value
-        data = ~data + 1;
-        data &= 0xFFFFFF; // Mask off the upper 8 bits
-        result = -data;
+        scan_idle = 0;
+        ADS1256_QueueScan();
     }
-    else // The value is positive
+    scan_late = 0;
+    __enable_irq();
+
+    if (period_us != ADS1256_FRAME_PERIOD_FREE)
     {
-        result = data;
+        __HAL_TIM_SET_AUTORELOAD(&htim3, period_us - 1);
+        __HAL_TIM_SET_COUNTER(&htim3, 0);
+        HAL_TIM_Base_Start_IT(&htim3);
     }
+}
 
-    return result;
+/**
+  * @brief  Start the next scan of the paced acquisition
+  * @retval None
+  *
+  * This function is called from the TIM3 update interrupt, at the same priority as the SPI queue and
+  * DRDY interrupts. If the previous scan is still running, its frame is flagged as late and the
+  * next scan starts at the following update.
+  */
+void dbh_ADS1256_TriggerScan(void)
+{
+    if (!scan_idle)
+    {
+        scan_late = 1;
+        return;
+    }
+
+    scan_idle = 0;
+    ADS1256_QueueScan();
+}
+
+/**
+  * @brief  EXTI line detection callback
+  * @param  GPIO_Pin: the pin connected to the EXTI line
+  * @retval None
+  *
+  * This function is called on the falling edge of the DRDY pins and releases the queued cycle of the device.
+  */
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+    uint8_t device = 0;
+
+    while (device < ADS1256_DEVICE_NUM && GPIO_Pin != DRDY_LINE(device))
+    {
+        device++;
+    }
+
+    if (device == ADS1256_DEVICE_NUM)
+    {
+        return; // Not a DRDY pin of the scan
+    }
+
+    if (scan_mode == ADS1256_MODE_SIMULTANEOUS)
+    {
+        drdy_ready |= 1 << device;
+
+        if (drdy_ready == (1 << ADS1256_DEVICE_NUM) - 1) // Every device has a result of the same conversion slot
+        {
+            dbh_SPIQueue_Trigger(ADS1256_TRIGGER_ALL);
+        }
+    }
+    else
+    {
+        dbh_SPIQueue_Trigger(device);
+    }
 }
@@ -21,6 +21,21 @@ extern "C" {
 #include "main.h"
 
 /* Exported macro ------------------------------------------------------------*/
+#define ADS1256_DEVICE_MAX        3 // Number of ADS1256 footprints on the board
+#ifndef ADS1256_DEVICE_NUM
+#define ADS1256_DEVICE_NUM        2 // Number of ADS1256 devices scanned by the acquisition engine, the first ones of the table, 3 when the third one is fitted
+#endif
+#define ADS1256_CHANNEL_NUM       (ADS1256_DEVICE_NUM * 8) // Each device converts AIN0-AIN7 against AINCOM
+
+// Scan modes
+#define ADS1256_MODE_OVERLAPPED   0 // The devices convert independently, each one is read as soon as its DRDY fires
+#define ADS1256_MODE_SIMULTANEOUS 1 // Every device is held by SYNC and woken back to back, the same channel is sampled within a few us
+
+// Frame periods in us, see dbh_ADS1256_SetFramePeriod()
+#define ADS1256_FRAME_PERIOD_FREE 0    // Free running, the next scan starts as soon as a frame is finished
+#define ADS1256_FRAME_PERIOD_1KHZ 1000
+#define ADS1256_FRAME_PERIOD_500HZ 2000
+
 // ADS1256 register map 
 #define ADS1256_REG_STATUS        0x00   
 #define ADS1256_REG_MUX           0x01   
@@ -104,10 +119,31 @@ extern "C" {
 #define ADS1256_DRATE_5SPS        0x13 // 5SPS = 0x0001 0011
 #define ADS1256_DRATE_2_5SPS      0x03 // 2.5SPS = 0x0000 0011
 
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  GPIO_TypeDef *drdy_port; /*!< Specifies the GPIO port of the DRDY pin */
+  uint16_t drdy_pin;       /*!< Specifies the DRDY pin, also the EXTI line */
+  uint16_t cs_pin;         /*!< Specifies the CS pin, all on SPI1_CS1_GPIO_Port */
+  uint8_t adcon;           /*!< Specifies the A/D control register value */
+  uint8_t drate;           /*!< Specifies the A/D data rate register value */
+} ADS1256_DEVICE_TypeDef;
+
+typedef struct
+{
+  uint32_t timestamp; /*!< Specifies the dbh_GetMicros() time when the scan of the frame started */
+  uint16_t sequence;  /*!< Specifies the number of the frame, incremented by every finished scan */
+  uint8_t late;       /*!< Specifies whether the scan overran the frame period */
+} ADS1256_FRAME_INFO_TypeDef;
+
 /* Exported functions ------------------------------------------------------- */
 void dbh_ADS1256_Init(uint8_t device);
-void dbh_ADS1256_SelectChannel(uint8_t channel, uint8_t device);
-int32_t dbh_ADS1256_ReadData(uint8_t device);
+void dbh_ADS1256_SetMode(uint8_t mode);
+void dbh_ADS1256_StartScan(void);
+uint8_t dbh_ADS1256_GetFrame(int32_t *samples);
+void dbh_ADS1256_SetFramePeriod(uint16_t period_us);
+void dbh_ADS1256_TriggerScan(void);
+const ADS1256_FRAME_INFO_TypeDef *dbh_ADS1256_GetFrameInfo(void);
 
 #ifdef __cplusplus
 }
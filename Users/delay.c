@@ -10,50 +10,55 @@
 
 #include "delay.h"
 
-static __IO uint32_t s_tick; //s_tick is set for the user's delay function.
-
 /**
- * @brief  Decrement the tick count
- * @note   This function should be called every 1 ms in the SysTick interrupt function.
+ * @brief  Delay for a specified number of milliseconds
+ * @param  delay_time_ms: The delay time in milliseconds
  * @retval None
+ *
+ * This function creates a delay by waiting until the HAL tick has advanced by delay_time_ms.
+ * The HAL tick is incremented every millisecond in the SysTick interrupt function.
  */
-void dbh_DecTick(void)
+void dbh_DelayMS(uint32_t delay_time_ms)
 {
-	if (s_tick != 0)
-	{
-		s_tick--;
-	}
-}
+	uint32_t start = HAL_GetTick();
 
-/**
- * @brief  Get the current tick count
- * @retval The current tick count
- */
-uint32_t GetTick(void)
-{
-	return s_tick;
+	while (HAL_GetTick() - start < delay_time_ms);
 }
 
 /**
- * @brief  Set the tick count
- * @param  set_tick: The value to set the tick count to
- * @retval None
+ * @brief  Get a free-running CPU cycle count
+ * @retval The number of CPU cycles since the SysTick was started, wraps around every 89 seconds at 48MHz
+ *
+ * This function combines the HAL millisecond tick with the SysTick down-counter, so short intervals
+ * can be measured with single cycle resolution. It is safe to call from interrupts that block the SysTick.
  */
-void SetTick(uint32_t set_tick)
+uint32_t dbh_GetCycles(void)
 {
-	s_tick = set_tick;
+	uint32_t tick = 0;
+	uint32_t value = 0;
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	tick = HAL_GetTick();
+	value = SysTick->VAL;
+	if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) // The counter reloaded but the SysTick interrupt has not run yet
+	{
+		tick++;
+		value = SysTick->VAL;
+	}
+	__set_PRIMASK(primask);
+
+	return tick * (SysTick->LOAD + 1) + (SysTick->LOAD - value);
 }
 
 /**
- * @brief  Delay for a specified number of milliseconds
- * @param  delay_time_ms: The delay time in milliseconds
- * @retval None
+ * @brief  Get the free-running microsecond timebase
+ * @retval The number of microseconds since TIM2 was started, wraps around every 71 minutes
  *
- * This function creates a delay by using a loop that waits until the tick count reaches zero.
- * The tick count is decremented every millisecond in the SysTick interrupt function.
+ * TIM2 is the only 32-bit timer of the STM32F042, it counts the 48MHz clock divided by 48 and is
+ * read in a single access, so this function is safe to call from any context.
  */
-void dbh_DelayMS(uint32_t delay_time_ms)
+uint32_t dbh_GetMicros(void)
 {
-	SetTick(delay_time_ms);
-	while (GetTick() != 0);
+	return TIM2->CNT;
 }
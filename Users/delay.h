@@ -19,7 +19,8 @@
 /* Exported constants --------------------------------------------------------*/
 /* Exported macro ------------------------------------------------------------*/
 /* Exported functions ------------------------------------------------------- */
-void dbh_DecTick(void);
 void dbh_DelayMS(uint32_t delay_time_ms);
+uint32_t dbh_GetCycles(void);
+uint32_t dbh_GetMicros(void);
 
 #endif /* __sDELAY_H */
@@ -11,9 +11,36 @@
 #include "drv2605l.h"
 #include "i2c.h"
 #include "delay.h"
+#include "tca9548a.h"
+#include "i2c_queue.h"
+#include "flash_store.h"
+
+#define DRV2605L_BROADCAST_JOB_NUM 3 // Enough for the MODE, WAV_SEQ_1 and GO broadcasts of one dbh_DRV2605L_PlayAll()
 
 __IO HAL_StatusTypeDef i2c_status;
 __IO DRV2605L_STATUS_TypeDef reg_status;
+DRV2605L_SHADOW_TypeDef shadow[DRV2605L_DEVICE_NUM] = {0}; // The register state of every device, to skip writes that change nothing
+DRV2605L_CAL_STORE_TypeDef cal_store = {0}; // The Auto-Calibration results of every device, mirrored in flash
+uint8_t cal_updated = 0; // New results were added to cal_store since it was loaded
+__IO uint8_t bringup_stage = DRV2605L_STAGE_MUX; // The progress of dbh_DRV2605L_BringUp()
+uint8_t bringup_device = 0; // The next device to initialize, or to poll while calibrating
+uint8_t bringup_read = 0; // The GO bit of bringup_device cleared, its results are read on the next step
+uint32_t bringup_start = 0; // The HAL tick when the last device was initialized
+uint32_t bringup_tick = 0; // The HAL tick of the last round of GO bit reads
+I2C_JOB_TypeDef device_job[DRV2605L_DEVICE_NUM]; // The play or stop job of every device
+I2C_OP_TypeDef device_ops[DRV2605L_DEVICE_NUM][4]; // GO (abort), MODE, WAV_SEQ_1 and GO
+I2C_JOB_TypeDef broadcast_job[DRV2605L_BROADCAST_JOB_NUM]; // The jobs of the broadcast writes
+I2C_OP_TypeDef broadcast_ops[DRV2605L_BROADCAST_JOB_NUM];
+
+/**
+  * @brief  Route the I2C bus to a DRV2605L through the TCA9548A
+  * @param  device: the DRV2605L device, 0 to DRV2605L_DEVICE_NUM - 1
+  * @retval None
+  */
+static void DRV2605L_Select(uint8_t device)
+{
+    dbh_TCA9548A_SelectChannel(device + DRV2605L_TCA_CHANNEL_OFFSET);
+}
 
 /**
   * @brief  Write data to a register of the DRV2605L
@@ -79,20 +106,51 @@ uint8_t DRV2605L_GetDIAG(void)
     return reg_status.DIAG_RESULT;
 }
 
+/**
+  * @brief  Load the Auto-Calibration results saved in flash by a previous boot
+  * @retval None
+  *
+  * This function must be called before the first dbh_DRV2605L_Init(). Without a valid record in flash,
+  * all devices are calibrated.
+  */
+void dbh_DRV2605L_LoadCalibration(void)
+{
+    if (!dbh_FlashStore_Load(&cal_store, sizeof(cal_store)))
+    {
+        cal_store.valid_mask = 0;
+    }
+}
+
+/**
+  * @brief  Erase the Auto-Calibration results saved in flash
+  * @retval None
+  *
+  * All devices are calibrated again on the next boot.
+  */
+void dbh_DRV2605L_ForgetCalibration(void)
+{
+    cal_store.valid_mask = 0;
+    dbh_FlashStore_Erase();
+}
+
 /**
   * @brief  Initialize the DRV2605L
   * @retval None
   *
-  * This function initializes the DRV2605L by configuring its registers and starting the auto-calibration process.
-  * It sets the feedback control register, control registers, and mode register according to the LRA specifications.
-  * It also reads the auto-calibration compensation result, back-EMF result, and back-EMF gain.
+  * This function initializes the DRV2605L by configuring its registers.
+  * It sets the feedback control register and control registers according to the LRA specifications.
+  * The calibration is set by dbh_DRV2605L_Calibrate(), the two are split so each call stays short.
+  * The I2C accesses are blocking, so this function must be called before any job is queued.
   */
-void dbh_DRV2605L_Init(void)
+void dbh_DRV2605L_Init(uint8_t device)
 {
-    uint8_t A_CAL_COMP = 0;
-    uint8_t A_CAL_BEMF = 0;
-    uint8_t BEMF_GAIN = 0;
+    shadow[device].present = 0;
+    shadow[device].calibrating = 0;
+    shadow[device].mode = DRV2605L_SHADOW_UNKNOWN;
+    shadow[device].wav_seq_1 = DRV2605L_SHADOW_UNKNOWN;
+    shadow[device].rtp_input = DRV2605L_SHADOW_UNKNOWN;
 
+    DRV2605L_Select(device);
     DRV2605L_GetStatus(); // Get the status of the DRV2605L
     if (reg_status.DEVICE_ID == 0x07) // If the device ID is correct, start the initialization
     {
@@ -123,74 +181,650 @@ void dbh_DRV2605L_Init(void)
         // Bit 4-0: 10011 - Set the DRIVE_TIME to 19 (0x13)
         DRV2605L_WriteReg(DRV2605L_REG_CTRL_1, 0x93);
         // DRV2605L_WriteReg(DRV2605L_REG_CTRL_2, 0xF5);
-        // DRV2605L_WriteReg(DRV2605L_REG_CTRL_3, 0x80);
+        // Set the control 3 register to 0x1010 1000
+        // Bit 7-6: 10 - NG_THRESH is 4% (default)
+        // Bit 5: 1 - ERM_OPEN_LOOP (default, unused for LRA)
+        // Bit 4: 0 - SUPPLY_COMP_DIS, supply compensation enabled (default)
+        // Bit 3: 1 - DATA_FORMAT_RTP is unsigned, RTP_INPUT 0x00-0xFF is the amplitude
+        // Bit 2: 0 - LRA_DRIVE_MODE is once per cycle (default)
+        // Bit 1: 0 - N_PWM_ANALOG is PWM input (default)
+        // Bit 0: 0 - LRA_OPEN_LOOP, auto-resonance mode (default)
+        DRV2605L_WriteReg(DRV2605L_REG_CTRL_3, 0xA8);
         // DRV2605L_WriteReg(DRV2605L_REG_CTRL_4, 0x20);
 
-        // Set the mode register to 0x0000 0111
-        // Bit 7: 0 - Device does not reset
-        // Bit 6: 0 - Device is not in standby mode
-        // Bit 5-3: 000 - Reserved
-        // Bit 2-0: 111 - Device is in Auto-Calibration mode. After Auto-Calibration, the bits will be set to 0x000 (Internal trigger)
-        DRV2605L_WriteReg(DRV2605L_REG_MODE, 0x07);
+        shadow[device].present = 1;
+    }
+}
+
+/**
+  * @brief  Calibrate a DRV2605L initialized by dbh_DRV2605L_Init()
+  * @param  device: the DRV2605L device, 0 to DRV2605L_DEVICE_NUM - 1
+  * @retval None
+  *
+  * If dbh_DRV2605L_LoadCalibration() found a result for this device, the result is written back,
+  * and the device is ready when this function returns. Otherwise the Auto-Calibration is started.
+  * It does not wait for the calibration, so all devices calibrate at the same time. The results are read
+  * by dbh_DRV2605L_BringUp(), which also calls this function.
+  */
+void dbh_DRV2605L_Calibrate(uint8_t device)
+{
+    if (!shadow[device].present)
+    {
+        return;
+    }
+
+    DRV2605L_Select(device);
+    if (cal_store.valid_mask & (1 << device)) // Calibrated on a previous boot
+    {
+        // Write back the auto-calibration results
+        DRV2605L_WriteReg(DRV2605L_REG_A_CAL_COMP, cal_store.device[device].A_CAL_COMP);
+        DRV2605L_WriteReg(DRV2605L_REG_A_CAL_BEMF, cal_store.device[device].A_CAL_BEMF);
+        DRV2605L_WriteReg(DRV2605L_REG_FEEDBACK_CTRL, (0xB6 & ~0x03) | cal_store.device[device].BEMF_GAIN);
+
+        // Set the mode register to 0x00, the internal trigger mode left by the Auto-Calibration
+        DRV2605L_WriteReg(DRV2605L_REG_MODE, 0x00);
+
+        shadow[device].mode = i2c_status == HAL_OK ? 0x00 : DRV2605L_SHADOW_UNKNOWN;
+        return;
+    }
+
+    // Set the mode register to 0x0000 0111
+    // Bit 7: 0 - Device does not reset
+    // Bit 6: 0 - Device is not in standby mode
+    // Bit 5-3: 000 - Reserved
+    // Bit 2-0: 111 - Device is in Auto-Calibration mode. After Auto-Calibration, the bits will be set to 0x000 (Internal trigger)
+    DRV2605L_WriteReg(DRV2605L_REG_MODE, 0x07);
+
+    // Set the GO register to 0x01 to start the Auto-Calibration
+    DRV2605L_WriteReg(DRV2605L_REG_GO, 0x01);
+
+    shadow[device].calibrating = 1; // The results are read by dbh_DRV2605L_BringUp()
+}
+
+/**
+  * @brief  Read the Auto-Calibration results of a DRV2605L
+  * @param  device: the DRV2605L device, selected on the TCA9548A
+  * @retval None
+  */
+static void DRV2605L_ReadCalibration(uint8_t device)
+{
+    uint8_t mode = 0;
+    DRV2605L_CALIBRATION_TypeDef *cal = &cal_store.device[device];
+
+    // Read the auto-calibration result
+    DRV2605L_GetStatus();
+    cal->DIAG_RESULT = reg_status.DIAG_RESULT;
+
+    // Read the auto-calibration compensation result
+    DRV2605L_ReadReg(DRV2605L_REG_A_CAL_COMP, &cal->A_CAL_COMP); // Read the A_CAL_COMP register
+
+    // Read the auto-calibration Back-EMF result
+    DRV2605L_ReadReg(DRV2605L_REG_A_CAL_BEMF, &cal->A_CAL_BEMF); // Read the A_CAL_BEMF register
+
+    // Read the auto-calibration Back-EMF gain
+    DRV2605L_ReadReg(DRV2605L_REG_FEEDBACK_CTRL, &cal->BEMF_GAIN); // Read the FEEDBACK_CTRL register
+    cal->BEMF_GAIN = cal->BEMF_GAIN & 0x03; // Bits [1:0] is BEMF_GAIN. For LRA Mode, 0x00 is 3.75x, 0x01 is 7.5x, 0x02 is 15x, 0x03 is 22.5x
+
+    // Seed the shadow with the mode left by the Auto-Calibration
+    DRV2605L_ReadReg(DRV2605L_REG_MODE, &mode);
+    shadow[device].mode = i2c_status == HAL_OK ? mode : DRV2605L_SHADOW_UNKNOWN;
+}
+
+/**
+  * @brief  Poll the GO bit of a calibrating DRV2605L
+  * @param  device: the DRV2605L device, 0 to DRV2605L_DEVICE_NUM - 1
+  * @retval 1 when done with the device for this round, 0 if its results must be read on the next step
+  *
+  * The results of the device are read on the step after its GO bit clears, so a step never does both.
+  * The successful ones are added to cal_store.valid_mask.
+  */
+static uint8_t DRV2605L_PollCalibration(uint8_t device)
+{
+    uint8_t go = 0;
+
+    DRV2605L_Select(device);
+    if (bringup_read) // The GO bit cleared on the last step
+    {
+        bringup_read = 0;
+        DRV2605L_ReadCalibration(device);
+        shadow[device].calibrating = 0;
+        if (i2c_status == HAL_OK && cal_store.device[device].DIAG_RESULT == 0) // Only keep a successful calibration
+        {
+            cal_store.valid_mask |= 1 << device;
+            cal_updated = 1;
+        }
+        return 1;
+    }
 
-        // Set the GO register to 0x01 to start the Auto-Calibration
-        DRV2605L_WriteReg(DRV2605L_REG_GO, 0x01);
+    DRV2605L_ReadReg(DRV2605L_REG_GO, &go);
+    if (i2c_status == HAL_OK && !(go & 0x01)) // The GO bit clears when the Auto-Calibration is done
+    {
+        bringup_read = 1;
+        return 0;
+    }
 
-        dbh_DelayMS(1000); // Wait for 1 second for the Auto-Calibration to complete
+    return 1;
+}
+
+/**
+  * @brief  Run one step of the haptic bring-up
+  * @retval the bring-up stage, DRV2605L_STAGE_READY when the haptics can be driven
+  *
+  * This function should be called from the main loop until it returns DRV2605L_STAGE_READY, so the
+  * sensor frames are streamed while the haptics come up. Each call blocks for at most the register
+  * configuration of one device, the calibration of one device, one GO bit read or one read of the
+  * results, about 0.5 ms at 400 kHz, so it fits in the 1 ms haptics task. All devices calibrate at the
+  * same time, and a device still calibrating after DRV2605L_CAL_TIMEOUT_MS is left out, like a missing
+  * device. New calibration results are saved in flash, which stalls the CPU once for the page erase.
+  * The I2C accesses are blocking, so no job must be queued before the bring-up is done.
+  */
+uint8_t dbh_DRV2605L_BringUp(void)
+{
+    uint8_t i = 0;
+    uint8_t pending = 0;
+
+    switch (bringup_stage)
+    {
+        case DRV2605L_STAGE_MUX:
+            dbh_TCA9548A_Init(); // Initialize the TCA9548A
+            dbh_DRV2605L_LoadCalibration(); // Skip the Auto-Calibration of the devices calibrated on a previous boot
+            bringup_device = 0;
+            bringup_stage = DRV2605L_STAGE_INIT;
+            break;
 
-        // Read the auto-calibration compensation result
-        DRV2605L_ReadReg(DRV2605L_REG_A_CAL_COMP, &A_CAL_COMP); // Read the A_CAL_COMP register
+        case DRV2605L_STAGE_INIT:
+            dbh_DRV2605L_Init(bringup_device); // Behind TCA9548A channel bringup_device + 3
+            bringup_stage = DRV2605L_STAGE_START;
+            break;
 
-        // Read the auto-calibration Back-EMF result
-        DRV2605L_ReadReg(DRV2605L_REG_A_CAL_BEMF, &A_CAL_BEMF); // Read the A_CAL_BEMF register
+        case DRV2605L_STAGE_START:
+            dbh_DRV2605L_Calibrate(bringup_device);
+            bringup_device++;
+            bringup_stage = DRV2605L_STAGE_INIT;
+            if (bringup_device >= DRV2605L_DEVICE_NUM)
+            {
+                bringup_tick = HAL_GetTick();
+                bringup_start = bringup_tick;
+                bringup_device = 0;
+                bringup_read = 0;
+                bringup_stage = DRV2605L_STAGE_CALIBRATE;
+            }
+            break;
 
-        // Read the auto-calibration Back-EMF gain
-        DRV2605L_ReadReg(DRV2605L_REG_FEEDBACK_CTRL, &BEMF_GAIN); // Read the FEEDBACK_CTRL register
-        BEMF_GAIN = BEMF_GAIN & 0x03; // Bits [1:0] is BEMF_GAIN. For LRA Mode, 0x00 is 3.75x, 0x01 is 7.5x, 0x02 is 15x, 0x03 is 22.5x
+        case DRV2605L_STAGE_CALIBRATE:
+            if (bringup_device == 0 && !bringup_read) // Start a round of GO bit reads
+            {
+                if (HAL_GetTick() - bringup_tick < DRV2605L_CAL_POLL_MS) // The Auto-Calibration takes hundreds of ms, don't flood the bus with reads
+                {
+                    break;
+                }
+                bringup_tick = HAL_GetTick();
+            }
+
+            while (bringup_device < DRV2605L_DEVICE_NUM && !shadow[bringup_device].calibrating)
+            {
+                bringup_device++; // Skip the devices without a running Auto-Calibration
+            }
+
+            if (bringup_device < DRV2605L_DEVICE_NUM) // Poll one device per step
+            {
+                if (DRV2605L_PollCalibration(bringup_device))
+                {
+                    bringup_device++;
+                }
+                break;
+            }
+
+            // End of the round
+            bringup_device = 0;
+            for (i = 0; i < DRV2605L_DEVICE_NUM; i++)
+            {
+                pending |= shadow[i].calibrating;
+            }
+            if (pending && bringup_tick - bringup_start < DRV2605L_CAL_TIMEOUT_MS)
+            {
+                break;
+            }
+
+            for (i = 0; i < DRV2605L_DEVICE_NUM; i++)
+            {
+                if (shadow[i].calibrating) // Timed out
+                {
+                    shadow[i].calibrating = 0;
+                    shadow[i].present = 0;
+                }
+            }
+            bringup_stage = DRV2605L_STAGE_SAVE;
+            break;
+
+        case DRV2605L_STAGE_SAVE:
+            if (cal_updated)
+            {
+                dbh_FlashStore_Save(&cal_store, sizeof(cal_store));
+                cal_updated = 0;
+            }
+            bringup_stage = DRV2605L_STAGE_READY;
+            break;
+
+        default:
+            break;
     }
+
+    return bringup_stage;
+}
+
+/**
+  * @brief  Get the haptic bring-up stage
+  * @retval DRV2605L_STAGE_MUX to DRV2605L_STAGE_READY
+  */
+uint8_t dbh_DRV2605L_GetStage(void)
+{
+    return bringup_stage;
+}
+
+/**
+  * @brief  Actuation callback
+  * @param  device: the DRV2605L device, 0 to DRV2605L_DEVICE_NUM - 1
+  * @retval None
+  *
+  * This function is called in interrupt context when a job that starts a waveform or drives an RTP
+  * amplitude went through. It does nothing here and can be implemented by the application.
+  */
+__weak void dbh_DRV2605L_ActuatedCallback(uint8_t device)
+{
+    UNUSED(device);
+}
+
+/**
+  * @brief  Check if a job makes the LRA move
+  * @param  job: the finished job
+  * @retval 1 if the job writes GO, RTP_INPUT or the RTP mode, 0 otherwise
+  */
+static uint8_t DRV2605L_IsActuation(I2C_JOB_TypeDef *job)
+{
+    uint8_t i = 0;
+    I2C_OP_TypeDef *op = NULL;
+
+    for (i = 0; i < job->op_count; i++)
+    {
+        op = &job->ops[i];
+        if ((op->reg == DRV2605L_REG_GO && op->data) || op->reg == DRV2605L_REG_RTP_INPUT ||
+            (op->reg == DRV2605L_REG_MODE && op->data == DRV2605L_MODE_RTP))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+  * @brief  I2C job complete callback
+  * @param  job: the finished job, one of device_job or broadcast_job
+  * @retval None
+  *
+  * The shadow is updated when a job is submitted. If the job failed, the registers of its devices are
+  * no longer known and are written again on the next play or stop.
+  */
+static void DRV2605L_JobCplt(I2C_JOB_TypeDef *job)
+{
+    uint8_t i = 0;
+    uint8_t device_mask = job->mux_mask >> DRV2605L_TCA_CHANNEL_OFFSET;
+
+    if (job->status != I2C_QUEUE_STATUS_ERROR)
+    {
+        if (DRV2605L_IsActuation(job))
+        {
+            for (i = 0; i < DRV2605L_DEVICE_NUM; i++)
+            {
+                if (device_mask & (1 << i))
+                {
+                    dbh_DRV2605L_ActuatedCallback(i);
+                }
+            }
+        }
+        return;
+    }
+
+    for (i = 0; i < DRV2605L_DEVICE_NUM; i++)
+    {
+        if (device_mask & (1 << i))
+        {
+            shadow[i].mode = DRV2605L_SHADOW_UNKNOWN;
+            shadow[i].wav_seq_1 = DRV2605L_SHADOW_UNKNOWN;
+            shadow[i].rtp_input = DRV2605L_SHADOW_UNKNOWN;
+        }
+    }
+}
+
+/**
+  * @brief  Fill and submit an I2C job for the DRV2605L
+  * @param  job: an idle job
+  * @param  device_mask: one bit per DRV2605L device receiving the operations
+  * @param  ops: the register writes
+  * @param  op_count: the number of register writes
+  * @retval None
+  */
+static void DRV2605L_Submit(I2C_JOB_TypeDef *job, uint8_t device_mask, I2C_OP_TypeDef *ops, uint8_t op_count)
+{
+    job->address = DRV2605L_SLAVE_ADDRESS;
+    job->mux_mask = device_mask << DRV2605L_TCA_CHANNEL_OFFSET;
+    job->ops = ops;
+    job->op_count = op_count;
+    job->callback = DRV2605L_JobCplt;
+    dbh_I2CQueue_Submit(job);
 }
 
 /**
   * @brief  Play a waveform on the DRV2605L
+  * @param  device: the DRV2605L device, 0 to DRV2605L_DEVICE_NUM - 1
   * @param  num: The waveform number to play (1-123)
-  * @retval None
+  * @param  abort: 1 to cancel the waveform still playing, so the new one starts at once, 0 to let it finish
+  * @retval 1 if the request was accepted, 0 if the previous request of the device is still in flight
   *
   * This function plays a waveform on the DRV2605L by writing the waveform number to the waveform sequence register.
   * It also sets the mode register to exit standby mode and starts the waveform sequence.
+  * MODE and WAV_SEQ_1 are only written when the shadow says they hold another value.
+  * The writes are queued on the I2C bus and the function returns at once.
   */
-void dbh_DRV2605L_PlayWaveform(uint8_t num)
+uint8_t dbh_DRV2605L_PlayWaveform(uint8_t device, uint8_t num, uint8_t abort)
 {
+    uint8_t n = 0;
     uint8_t waveform = num;
+    DRV2605L_SHADOW_TypeDef *dev = &shadow[device];
+    I2C_OP_TypeDef *ops = device_ops[device];
+
+    if (!dev->present)
+    {
+        return 1; // No device to talk to
+    }
+
+    if (!dbh_I2CQueue_IsIdle(&device_job[device]))
+    {
+        return 0;
+    }
 
     waveform = waveform > 123 ? 123 : waveform; // Limit the waveform to 123
     waveform = waveform < 1 ? 1 : waveform; // Limit the waveform to 1
 
-    DRV2605L_WriteReg(DRV2605L_REG_MODE, 0x00); // Set the mode register to 0x00 to exit the standby mode
-    
-    DRV2605L_WriteReg(DRV2605L_REG_WAV_SEQ_1, waveform); // Set the waveform sequence to the selected waveform
+    if (abort && dev->mode == 0x00) // A waveform may be playing, a GO write would not restart it
+    {
+        // Clear the GO bit to cancel the waveform sequence
+        ops[n].type = I2C_OP_WRITE;
+        ops[n].reg = DRV2605L_REG_GO;
+        ops[n++].data = 0x00;
+    }
 
-    DRV2605L_WriteReg(DRV2605L_REG_GO, 0x01); // Start the waveform sequence
+    if (dev->mode != 0x00)
+    {
+        // Set the mode register to 0x00 to exit the standby mode
+        ops[n].type = I2C_OP_WRITE;
+        ops[n].reg = DRV2605L_REG_MODE;
+        ops[n++].data = 0x00;
+        dev->mode = 0x00;
+    }
+
+    if (dev->wav_seq_1 != waveform)
+    {
+        // Set the waveform sequence to the selected waveform
+        ops[n].type = I2C_OP_WRITE;
+        ops[n].reg = DRV2605L_REG_WAV_SEQ_1;
+        ops[n++].data = waveform;
+        dev->wav_seq_1 = waveform;
+    }
+
+    // Start the waveform sequence
+    ops[n].type = I2C_OP_WRITE;
+    ops[n].reg = DRV2605L_REG_GO;
+    ops[n++].data = 0x01;
+
+    DRV2605L_Submit(&device_job[device], 1 << device, ops, n);
+
+    return 1;
 }
 
 /**
   * @brief  Stop the waveform sequence on the DRV2605L
-  * @retval None
+  * @param  device: the DRV2605L device, 0 to DRV2605L_DEVICE_NUM - 1
+  * @retval 1 if the request was accepted, 0 if the previous request of the device is still in flight
   *
   * This function stops the waveform sequence on the DRV2605L by setting the mode register to standby mode.
+  * A device already in standby costs no I2C transaction.
   */
-void dbh_DRV2605L_StopWaveform(void)
+uint8_t dbh_DRV2605L_StopWaveform(uint8_t device)
 {
-    uint8_t mode = 0;
+    DRV2605L_SHADOW_TypeDef *dev = &shadow[device];
+    I2C_OP_TypeDef *ops = device_ops[device];
+
+    if (!dev->present || (dev->mode != DRV2605L_SHADOW_UNKNOWN && (dev->mode & 0x40)))
+    {
+        return 1; // No device to talk to, or already in standby mode
+    }
+
+    if (!dbh_I2CQueue_IsIdle(&device_job[device]))
+    {
+        return 0;
+    }
+
+    // Set the standby mode
+    // Bit 7: DEV_RESET
+    // Bit 6: 1 - Device is in standby mode
+    // Bit 5-3: Reserved
+    // Bit 2-0: 000 - Internal trigger, the mode PlayWaveform uses
+    ops[0].type = I2C_OP_WRITE;
+    ops[0].reg = DRV2605L_REG_MODE;
+    ops[0].data = 0x40;
+    dev->mode = 0x40;
+
+    DRV2605L_Submit(&device_job[device], 1 << device, ops, 1);
+
+    return 1;
+}
+
+/**
+  * @brief  Drive the LRA with an amplitude in real-time playback mode
+  * @param  device: the DRV2605L device, 0 to DRV2605L_DEVICE_NUM - 1
+  * @param  amplitude: the drive amplitude, 0x00 (off) to 0xFF (full scale)
+  * @retval 1 if the request was accepted, 0 if the previous request of the device is still in flight
+  *
+  * The first call switches the device to the RTP mode. After that, only RTP_INPUT is written, and only
+  * when the amplitude changes, so a 1 kHz amplitude stream costs one register write per finger and
+  * update. dbh_DRV2605L_PlayWaveform() or a stop leaves the RTP mode.
+  */
+uint8_t dbh_DRV2605L_SetRTP(uint8_t device, uint8_t amplitude)
+{
+    uint8_t n = 0;
+    DRV2605L_SHADOW_TypeDef *dev = &shadow[device];
+    I2C_OP_TypeDef *ops = device_ops[device];
+
+    if (!dev->present)
+    {
+        return 1; // No device to talk to
+    }
+
+    if (!dbh_I2CQueue_IsIdle(&device_job[device]))
+    {
+        return 0;
+    }
+
+    if (dev->rtp_input != amplitude)
+    {
+        // Write the amplitude before entering the mode, so the old one is never played
+        ops[n].type = I2C_OP_WRITE;
+        ops[n].reg = DRV2605L_REG_RTP_INPUT;
+        ops[n++].data = amplitude;
+        dev->rtp_input = amplitude;
+    }
+
+    if (dev->mode != DRV2605L_MODE_RTP)
+    {
+        // Set the mode register to 0x05 to exit the standby mode and enter the RTP mode
+        ops[n].type = I2C_OP_WRITE;
+        ops[n].reg = DRV2605L_REG_MODE;
+        ops[n++].data = DRV2605L_MODE_RTP;
+        dev->mode = DRV2605L_MODE_RTP;
+    }
+
+    if (n)
+    {
+        DRV2605L_Submit(&device_job[device], 1 << device, ops, n);
+    }
+
+    return 1;
+}
+
+/**
+  * @brief  Count the idle broadcast jobs
+  * @retval the number of broadcast writes that can be queued now
+  */
+static uint8_t DRV2605L_FreeBroadcastJobs(void)
+{
+    uint8_t i = 0;
+    uint8_t count = 0;
+
+    for (i = 0; i < DRV2605L_BROADCAST_JOB_NUM; i++)
+    {
+        if (dbh_I2CQueue_IsIdle(&broadcast_job[i]))
+        {
+            count++;
+        }
+    }
 
-    DRV2605L_ReadReg(DRV2605L_REG_MODE, &mode); // Read the mode register
+    return count;
+}
 
-    if (!(mode & 0x40)) // If the device is not in standby mode
+/**
+  * @brief  Write the same register on several DRV2605L in one I2C transaction
+  * @param  device_mask: one bit per DRV2605L device, bit 0 for device 0
+  * @param  reg: The register address to write to
+  * @param  data: The data to write to the register
+  * @retval 1 if the request was accepted, 0 if all broadcast jobs are in flight
+  *
+  * All DRV2605L share the same address, so with their TCA9548A channels enabled together they all
+  * receive the write. Devices that failed the initialization are left out.
+  */
+uint8_t dbh_DRV2605L_BroadcastReg(uint8_t device_mask, uint8_t reg, uint8_t data)
+{
+    uint8_t i = 0;
+    uint8_t mask = 0;
+    I2C_JOB_TypeDef *job = NULL;
+
+    for (i = 0; i < DRV2605L_DEVICE_NUM; i++)
     {
-        // Set the standby mode
-        // Bit 7: DEV_RESET
-        // Bit 6: 1 - Device is in standby mode
-        // Bit 5-3: Reserved
-        // Bit 2-0: Mode
-        DRV2605L_WriteReg(DRV2605L_REG_MODE, 0x40 | mode); // Set the mode register to standby mode
+        if ((device_mask & (1 << i)) && shadow[i].present)
+        {
+            mask |= 1 << i;
+        }
     }
+
+    if (mask == 0)
+    {
+        return 1; // No device to talk to
+    }
+
+    for (i = 0; i < DRV2605L_BROADCAST_JOB_NUM && job == NULL; i++)
+    {
+        if (dbh_I2CQueue_IsIdle(&broadcast_job[i]))
+        {
+            job = &broadcast_job[i];
+        }
+    }
+
+    if (job == NULL)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < DRV2605L_DEVICE_NUM; i++)
+    {
+        if (mask & (1 << i))
+        {
+            if (reg == DRV2605L_REG_MODE)
+            {
+                shadow[i].mode = data;
+            }
+            else if (reg == DRV2605L_REG_WAV_SEQ_1)
+            {
+                shadow[i].wav_seq_1 = data;
+            }
+        }
+    }
+
+    i = job - broadcast_job;
+    broadcast_ops[i].type = I2C_OP_WRITE;
+    broadcast_ops[i].reg = reg;
+    broadcast_ops[i].data = data;
+    DRV2605L_Submit(job, mask, &broadcast_ops[i], 1);
+
+    return 1;
+}
+
+/**
+  * @brief  Play the same waveform on several DRV2605L at the same time
+  * @param  device_mask: one bit per DRV2605L device, bit 0 for device 0
+  * @param  num: The waveform number to play (1-123)
+  * @retval 1 if the request was accepted, 0 if the broadcast jobs are in flight
+  *
+  * MODE and WAV_SEQ_1 are only written on the devices whose shadow holds another value, then a single
+  * GO starts all devices together.
+  */
+uint8_t dbh_DRV2605L_PlayAll(uint8_t device_mask, uint8_t num)
+{
+    uint8_t i = 0;
+    uint8_t mode_mask = 0;
+    uint8_t wave_mask = 0;
+    uint8_t waveform = num;
+
+    if (DRV2605L_FreeBroadcastJobs() < 3)
+    {
+        return 0;
+    }
+
+    waveform = waveform > 123 ? 123 : waveform; // Limit the waveform to 123
+    waveform = waveform < 1 ? 1 : waveform; // Limit the waveform to 1
+
+    for (i = 0; i < DRV2605L_DEVICE_NUM; i++)
+    {
+        if (device_mask & (1 << i))
+        {
+            if (shadow[i].mode != 0x00)
+            {
+                mode_mask |= 1 << i;
+            }
+            if (shadow[i].wav_seq_1 != waveform)
+            {
+                wave_mask |= 1 << i;
+            }
+        }
+    }
+
+    dbh_DRV2605L_BroadcastReg(mode_mask, DRV2605L_REG_MODE, 0x00); // Exit the standby mode
+    dbh_DRV2605L_BroadcastReg(wave_mask, DRV2605L_REG_WAV_SEQ_1, waveform); // Set the waveform sequence
+    dbh_DRV2605L_BroadcastReg(device_mask, DRV2605L_REG_GO, 0x01); // Start the waveform sequence
+
+    return 1;
+}
+
+/**
+  * @brief  Put several DRV2605L in standby mode at the same time
+  * @param  device_mask: one bit per DRV2605L device, bit 0 for device 0
+  * @retval 1 if the request was accepted, 0 if all broadcast jobs are in flight
+  *
+  * Devices already in standby are left out, so stopping idle fingers costs no I2C transaction.
+  */
+uint8_t dbh_DRV2605L_StopAll(uint8_t device_mask)
+{
+    uint8_t i = 0;
+    uint8_t mask = 0;
+
+    for (i = 0; i < DRV2605L_DEVICE_NUM; i++)
+    {
+        if ((device_mask & (1 << i)) && (shadow[i].mode == DRV2605L_SHADOW_UNKNOWN || !(shadow[i].mode & 0x40)))
+        {
+            mask |= 1 << i;
+        }
+    }
+
+    // Set the standby mode with the internal trigger, the mode PlayWaveform uses
+    return dbh_DRV2605L_BroadcastReg(mask, DRV2605L_REG_MODE, 0x40);
 }
@@ -67,6 +67,22 @@ extern "C" {
 //DRV2605L I2C Slave Address
 #define DRV2605L_SLAVE_ADDRESS                  (0x5A<<1) //The LSB is the R/W bit
 
+//DRV2605L devices, one per finger, behind the TCA9548A
+#define DRV2605L_DEVICE_NUM                     5 //Number of DRV2605L devices
+#define DRV2605L_TCA_CHANNEL_OFFSET             3 //Device 0 is on TCA9548A channel 3, device 4 on channel 7
+#define DRV2605L_SHADOW_UNKNOWN                 0xFF //The register content is unknown and must be written
+#define DRV2605L_MODE_RTP                       0x05 //MODE register value of the real-time playback mode
+#define DRV2605L_CAL_TIMEOUT_MS                 2000 //Give up on an Auto-Calibration that has not finished after this time
+#define DRV2605L_CAL_POLL_MS                    10 //Interval between two reads of the GO bits while calibrating
+
+//Haptic bring-up stages, see dbh_DRV2605L_BringUp()
+#define DRV2605L_STAGE_MUX                      0 //The TCA9548A is initialized and the saved calibration loaded
+#define DRV2605L_STAGE_INIT                     1 //The registers of a device are configured, one device per step
+#define DRV2605L_STAGE_START                    2 //The calibration of that device is written back or its Auto-Calibration started
+#define DRV2605L_STAGE_CALIBRATE                3 //The Auto-Calibrations are running, one device is polled per step
+#define DRV2605L_STAGE_SAVE                     4 //The new calibration results are saved in flash
+#define DRV2605L_STAGE_READY                    5 //The haptics can be driven
+
 typedef struct
 {
   __IO uint8_t DEVICE_ID;     /*!< Specifies the device ID, BIT[7:5] */
@@ -75,11 +91,44 @@ typedef struct
   __IO uint8_t OC_DETECT;     /*!< Specifies the over current detection status, BIT[0] */
 } DRV2605L_STATUS_TypeDef;
 
+typedef struct
+{
+  uint8_t present;            /*!< Specifies whether the device answered with the right ID during initialization */
+  uint8_t calibrating;        /*!< Specifies whether the Auto-Calibration was started and its result not read yet */
+  uint8_t mode;               /*!< Specifies the last value written to the MODE register, or DRV2605L_SHADOW_UNKNOWN */
+  uint8_t wav_seq_1;          /*!< Specifies the last value written to the WAV_SEQ_1 register, or DRV2605L_SHADOW_UNKNOWN */
+  uint8_t rtp_input;          /*!< Specifies the last value written to the RTP_INPUT register */
+} DRV2605L_SHADOW_TypeDef;
+
+typedef struct
+{
+  uint8_t A_CAL_COMP;         /*!< Specifies the auto-calibration compensation result */
+  uint8_t A_CAL_BEMF;         /*!< Specifies the auto-calibration back-EMF result */
+  uint8_t BEMF_GAIN;          /*!< Specifies the back-EMF gain, BIT[1:0] of FEEDBACK_CTRL */
+  uint8_t DIAG_RESULT;        /*!< Specifies the Auto-Calibration result, 0 for success */
+} DRV2605L_CALIBRATION_TypeDef;
+
+typedef struct
+{
+  uint8_t valid_mask;                                       /*!< Specifies the devices with a successful Auto-Calibration result, one bit per device */
+  DRV2605L_CALIBRATION_TypeDef device[DRV2605L_DEVICE_NUM]; /*!< Specifies the Auto-Calibration results of every device */
+} DRV2605L_CAL_STORE_TypeDef;
+
 
 /* Exported functions ------------------------------------------------------- */
-void dbh_DRV2605L_Init(void);
-void dbh_DRV2605L_PlayWaveform(uint8_t num);
-void dbh_DRV2605L_StopWaveform(void);
+void dbh_DRV2605L_LoadCalibration(void);
+void dbh_DRV2605L_ForgetCalibration(void);
+void dbh_DRV2605L_Init(uint8_t device);
+void dbh_DRV2605L_Calibrate(uint8_t device);
+uint8_t dbh_DRV2605L_BringUp(void);
+uint8_t dbh_DRV2605L_GetStage(void);
+uint8_t dbh_DRV2605L_PlayWaveform(uint8_t device, uint8_t num, uint8_t abort);
+uint8_t dbh_DRV2605L_StopWaveform(uint8_t device);
+uint8_t dbh_DRV2605L_SetRTP(uint8_t device, uint8_t amplitude);
+uint8_t dbh_DRV2605L_BroadcastReg(uint8_t device_mask, uint8_t reg, uint8_t data);
+uint8_t dbh_DRV2605L_PlayAll(uint8_t device_mask, uint8_t num);
+uint8_t dbh_DRV2605L_StopAll(uint8_t device_mask);
+void dbh_DRV2605L_ActuatedCallback(uint8_t device);
 void DRV2605L_GetStatus(void);
 uint8_t DRV2605L_GetDIAG(void);
 
@@ -0,0 +1,135 @@
+/**
+  ******************************************************************************
+  * @file    flash_store.c
+  * @brief   This file contains the functions to keep a small record in the last flash page
+  * @author  doublehan07
+  * @version V1.0
+  * @date    2026-10-17
+  ******************************************************************************
+  */
+
+#include "flash_store.h"
+#include <string.h>
+
+// Page layout, in half-words: Magic | Size | Data (padded to a half-word) | Checksum
+#define FLASH_STORE_MAGIC_ADDR    (FLASH_STORE_ADDRESS)
+#define FLASH_STORE_SIZE_ADDR     (FLASH_STORE_ADDRESS + 2)
+#define FLASH_STORE_DATA_ADDR     (FLASH_STORE_ADDRESS + 4)
+#define FLASH_STORE_CHECKSUM_ADDR(size) (FLASH_STORE_DATA_ADDR + (((size) + 1) & ~1))
+
+/**
+  * @brief  Compute the checksum of a record
+  * @param  data: the record
+  * @param  size: the size of the record in bytes
+  * @retval the inverted 16-bit sum of the size and the data, so an all-zero page does not pass
+  */
+static uint16_t FlashStore_Checksum(const uint8_t *data, uint16_t size)
+{
+    uint16_t i = 0;
+    uint16_t sum = size;
+
+    for (i = 0; i < size; i++)
+    {
+        sum += data[i];
+    }
+
+    return ~sum;
+}
+
+/**
+  * @brief  Read the record stored in flash
+  * @param  data: receives the record, left untouched if the page holds no valid record
+  * @param  size: the size of the record in bytes
+  * @retval 1 if a valid record of this size was found, 0 otherwise
+  */
+uint8_t dbh_FlashStore_Load(void *data, uint16_t size)
+{
+    const uint8_t *stored = (const uint8_t *)FLASH_STORE_DATA_ADDR;
+
+    if (FLASH_STORE_CHECKSUM_ADDR(size) + 2 > FLASH_STORE_ADDRESS + FLASH_STORE_PAGE_SIZE)
+    {
+        return 0;
+    }
+
+    if (*(__IO uint16_t *)FLASH_STORE_MAGIC_ADDR != FLASH_STORE_MAGIC
+        || *(__IO uint16_t *)FLASH_STORE_SIZE_ADDR != size // Written by another firmware version
+        || *(__IO uint16_t *)FLASH_STORE_CHECKSUM_ADDR(size) != FlashStore_Checksum(stored, size))
+    {
+        return 0;
+    }
+
+    memcpy(data, stored, size);
+
+    return 1;
+}
+
+/**
+  * @brief  Erase the page and write a record
+  * @param  data: the record
+  * @param  size: the size of the record in bytes
+  * @retval 1 if successful, 0 if failed
+  *
+  * The CPU stalls for about 40 ms while the page is erased, so this function must not be called
+  * while the haptics are driven.
+  */
+uint8_t dbh_FlashStore_Save(const void *data, uint16_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint16_t i = 0;
+    uint16_t half_word = 0;
+    HAL_StatusTypeDef status = HAL_OK;
+    FLASH_EraseInitTypeDef erase = {0};
+    uint32_t page_error = 0;
+
+    if (FLASH_STORE_CHECKSUM_ADDR(size) + 2 > FLASH_STORE_ADDRESS + FLASH_STORE_PAGE_SIZE)
+    {
+        return 0;
+    }
+
+    erase.TypeErase = FLASH_TYPEERASE_PAGES;
+    erase.PageAddress = FLASH_STORE_ADDRESS;
+    erase.NbPages = 1;
+
+    HAL_FLASH_Unlock();
+    status = HAL_FLASHEx_Erase(&erase, &page_error);
+
+    // Write the data first and the magic last, so an interrupted save leaves no valid record
+    for (i = 0; i < size && status == HAL_OK; i += 2)
+    {
+        half_word = bytes[i] | ((i + 1 < size ? bytes[i + 1] : 0xFF) << 8);
+        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, FLASH_STORE_DATA_ADDR + i, half_word);
+    }
+    if (status == HAL_OK)
+    {
+        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, FLASH_STORE_CHECKSUM_ADDR(size), FlashStore_Checksum(bytes, size));
+    }
+    if (status == HAL_OK)
+    {
+        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, FLASH_STORE_SIZE_ADDR, size);
+    }
+    if (status == HAL_OK)
+    {
+        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, FLASH_STORE_MAGIC_ADDR, FLASH_STORE_MAGIC);
+    }
+    HAL_FLASH_Lock();
+
+    return status == HAL_OK;
+}
+
+/**
+  * @brief  Erase the page, so the next dbh_FlashStore_Load() finds no record
+  * @retval None
+  */
+void dbh_FlashStore_Erase(void)
+{
+    FLASH_EraseInitTypeDef erase = {0};
+    uint32_t page_error = 0;
+
+    erase.TypeErase = FLASH_TYPEERASE_PAGES;
+    erase.PageAddress = FLASH_STORE_ADDRESS;
+    erase.NbPages = 1;
+
+    HAL_FLASH_Unlock();
+    HAL_FLASHEx_Erase(&erase, &page_error);
+    HAL_FLASH_Lock();
+}
@@ -0,0 +1,37 @@
+/**
+  ******************************************************************************
+  * @file    flash_store.h
+  * @brief   This file contains the definitions and function prototypes
+  *          for the flash_store.c file.
+  * @author  doublehan07
+  * @version V1.0
+  * @date    2026-10-17
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FLASH_STORE_H
+#define __FLASH_STORE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported macro ------------------------------------------------------------*/
+#define FLASH_STORE_ADDRESS       0x08007C00 // The last 1 KB page of the flash, left out of the FLASH region of the linker script
+#define FLASH_STORE_PAGE_SIZE     0x400
+#define FLASH_STORE_MAGIC         0xCA1B // Marks a page written by dbh_FlashStore_Save(), an erased page reads 0xFFFF
+
+/* Exported functions prototypes ---------------------------------------------*/
+uint8_t dbh_FlashStore_Load(void *data, uint16_t size);
+uint8_t dbh_FlashStore_Save(const void *data, uint16_t size);
+void dbh_FlashStore_Erase(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FLASH_STORE_H */
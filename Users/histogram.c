@@ -0,0 +1,62 @@
+/**
+  ******************************************************************************
+  * @file    histogram.c
+  * @brief   This file contains the functions to keep the log2 timing histograms
+  * @author  doublehan07
+  * @version V1.0
+  * @date    2026-10-17
+  ******************************************************************************
+  */
+
+#include "histogram.h"
+
+HISTOGRAM_TypeDef histograms[HISTOGRAM_NUM] = {0}; // The counts since the last fetch
+
+/**
+  * @brief  Count a value in its log2 bin
+  * @param  histogram: the histogram, see HISTOGRAM_*
+  * @param  value_us: the measured time in us
+  * @retval None
+  *
+  * This function is called from the main loop and from the interrupts. The bin is found from the
+  * leading zeros of the value, so counting costs the same for any value.
+  */
+void dbh_Histogram_Add(uint8_t histogram, uint32_t value_us)
+{
+    uint16_t *bin = NULL;
+    uint8_t index = value_us ? 32 - __CLZ(value_us) : 0;
+    uint32_t primask = __get_PRIMASK();
+
+    if (index >= HISTOGRAM_BINS)
+    {
+        index = HISTOGRAM_BINS - 1;
+    }
+    bin = &histograms[histogram].bins[index];
+
+    __disable_irq();
+    if (*bin != 0xFFFF)
+    {
+        (*bin)++;
+    }
+    __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Copy a histogram and clear it for the next window
+  * @param  histogram: the histogram, see HISTOGRAM_*
+  * @param  copy: receives the counts since the last fetch
+  * @retval None
+  */
+void dbh_Histogram_Fetch(uint8_t histogram, HISTOGRAM_TypeDef *copy)
+{
+    uint8_t i = 0;
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    for (i = 0; i < HISTOGRAM_BINS; i++)
+    {
+        copy->bins[i] = histograms[histogram].bins[i];
+        histograms[histogram].bins[i] = 0;
+    }
+    __set_PRIMASK(primask);
+}
@@ -0,0 +1,46 @@
+/**
+  ******************************************************************************
+  * @file    histogram.h
+  * @brief   This file contains the type definitions and function prototypes
+  *          for the histogram.c file.
+  * @author  doublehan07
+  * @version V1.0
+  * @date    2026-10-17
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HISTOGRAM_H
+#define __HISTOGRAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported macro ------------------------------------------------------------*/
+// Bin 0 counts the value 0, bin n counts [2^(n-1), 2^n) us, the last bin also counts everything above
+#define HISTOGRAM_BINS            16
+
+// Recorded histograms
+#define HISTOGRAM_FRAME_INTERVAL  0 // Time between two sample frames handed to the UART
+#define HISTOGRAM_COMMAND_LATENCY 1 // Time from the reception of a haptic command to the end of its DRV2605L writes
+#define HISTOGRAM_NUM             2
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint16_t bins[HISTOGRAM_BINS]; /*!< Specifies the counts of every bin, saturated at 0xFFFF */
+} HISTOGRAM_TypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+void dbh_Histogram_Add(uint8_t histogram, uint32_t value_us);
+void dbh_Histogram_Fetch(uint8_t histogram, HISTOGRAM_TypeDef *copy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HISTOGRAM_H */
@@ -0,0 +1,246 @@
+/**
+  ******************************************************************************
+  * @file    i2c_queue.c
+  * @brief   This file contains the interrupt driven job queue of I2C1
+  * @author  doublehan07
+  * @version V1.0
+  * @date    2026-10-17
+  ******************************************************************************
+  */
+
+#include "i2c_queue.h"
+#include "i2c.h"
+#include "tca9548a.h"
+#include "profiler.h"
+
+I2C_JOB_TypeDef *job_head = NULL; // The oldest job waiting for the bus
+I2C_JOB_TypeDef *job_tail = NULL; // The newest job waiting for the bus
+I2C_JOB_TypeDef *active_job = NULL; // The job on the bus
+uint8_t op_index = 0; // The operation of active_job on the bus
+uint8_t mux_tx = 0; // The TCA9548A control register being written
+__IO uint32_t i2c_errors = 0; // Jobs finished with I2C_QUEUE_STATUS_ERROR
+uint32_t mux_start = 0; // The cycle count when the TCA9548A write started
+uint32_t ops_start = 0; // The cycle count when the first operation of the active job started
+
+static void I2CQueue_Start(void);
+
+/**
+  * @brief  Put the current operation of the active job on the bus
+  * @retval None
+  */
+static void I2CQueue_StartOp(void)
+{
+    I2C_OP_TypeDef *op = &active_job->ops[op_index];
+    HAL_StatusTypeDef status = HAL_OK;
+
+    if (op_index == 0)
+    {
+        PROFILER_START(ops_start);
+    }
+
+    if (op->type == I2C_OP_READ)
+    {
+        status = HAL_I2C_Mem_Read_IT(&hi2c1, active_job->address, op->reg, I2C_MEMADD_SIZE_8BIT, &op->data, 1);
+    }
+    else
+    {
+        status = HAL_I2C_Mem_Write_IT(&hi2c1, active_job->address, op->reg, I2C_MEMADD_SIZE_8BIT, &op->data, 1);
+    }
+
+    if (status != HAL_OK)
+    {
+        HAL_I2C_ErrorCallback(&hi2c1);
+    }
+}
+
+/**
+  * @brief  Finish the active job and start the next one
+  * @param  status: I2C_QUEUE_STATUS_DONE or I2C_QUEUE_STATUS_ERROR
+  * @retval None
+  */
+static void I2CQueue_Finish(uint8_t status)
+{
+    I2C_JOB_TypeDef *job = active_job;
+
+    active_job = NULL;
+    job->status = status;
+
+    if (job->callback != NULL)
+    {
+        job->callback(job); // May submit new jobs
+    }
+
+    I2CQueue_Start();
+}
+
+/**
+  * @brief  Advance the active job after an operation finished
+  * @retval None
+  */
+static void I2CQueue_NextOp(void)
+{
+    op_index++;
+
+    if (op_index < active_job->op_count)
+    {
+        I2CQueue_StartOp();
+    }
+    else
+    {
+        PROFILER_STOP(PROFILER_STAGE_DRV_JOB, ops_start);
+        I2CQueue_Finish(I2C_QUEUE_STATUS_DONE);
+    }
+}
+
+/**
+  * @brief  Put the oldest job on the bus
+  * @retval None
+  *
+  * The TCA9548A is only written when the job needs other channels than the ones already open.
+  * Interrupts must be disabled, or the function is called from an I2C interrupt.
+  */
+static void I2CQueue_Start(void)
+{
+    I2C_JOB_TypeDef *job = job_head;
+
+    if (active_job != NULL || job == NULL)
+    {
+        return;
+    }
+
+    job_head = job->next;
+    if (job_head == NULL)
+    {
+        job_tail = NULL;
+    }
+
+    active_job = job;
+    job->status = I2C_QUEUE_STATUS_BUSY;
+    op_index = 0;
+
+    if (!dbh_TCA9548A_IsSelected(job->mux_mask))
+    {
+        mux_tx = job->mux_mask;
+        PROFILER_START(mux_start);
+        if (HAL_I2C_Master_Transmit_IT(&hi2c1, TCA9548A_SLAVE_ADDRESS, &mux_tx, 1) != HAL_OK)
+        {
+            HAL_I2C_ErrorCallback(&hi2c1);
+        }
+    }
+    else if (job->op_count)
+    {
+        I2CQueue_StartOp();
+    }
+    else
+    {
+        I2CQueue_Finish(I2C_QUEUE_STATUS_DONE);
+    }
+}
+
+/**
+  * @brief  Add a job to the end of the queue
+  * @param  job: the job, it must stay valid until its status is I2C_QUEUE_STATUS_DONE or I2C_QUEUE_STATUS_ERROR
+  * @retval None
+  *
+  * The blocking HAL_I2C functions must not be used on hi2c1 while jobs are in flight.
+  */
+void dbh_I2CQueue_Submit(I2C_JOB_TypeDef *job)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    job->next = NULL;
+    job->status = I2C_QUEUE_STATUS_QUEUED;
+
+    if (job_tail == NULL)
+    {
+        job_head = job;
+    }
+    else
+    {
+        job_tail->next = job;
+    }
+    job_tail = job;
+
+    I2CQueue_Start();
+    __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Check if a job can be filled and submitted again
+  * @param  job: the job
+  * @retval 1 if the job is not queued nor on the bus, 0 otherwise
+  */
+uint8_t dbh_I2CQueue_IsIdle(I2C_JOB_TypeDef *job)
+{
+    return job->status == I2C_QUEUE_STATUS_DONE || job->status == I2C_QUEUE_STATUS_ERROR;
+}
+
+/**
+  * @brief  I2C master transmit complete callback
+  * @param  hi2c: I2C handle
+  * @retval None
+  *
+  * This function is called when the TCA9548A control register is written.
+  */
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c->Instance == I2C1 && active_job != NULL)
+    {
+        dbh_TCA9548A_SetSelected(mux_tx);
+        PROFILER_STOP(PROFILER_STAGE_TCA_SELECT, mux_start);
+
+        if (active_job->op_count)
+        {
+            I2CQueue_StartOp();
+        }
+        else
+        {
+            I2CQueue_Finish(I2C_QUEUE_STATUS_DONE);
+        }
+    }
+}
+
+/**
+  * @brief  I2C memory write complete callback
+  * @param  hi2c: I2C handle
+  * @retval None
+  */
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c->Instance == I2C1 && active_job != NULL)
+    {
+        I2CQueue_NextOp();
+    }
+}
+
+/**
+  * @brief  I2C memory read complete callback
+  * @param  hi2c: I2C handle
+  * @retval None
+  */
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c->Instance == I2C1 && active_job != NULL)
+    {
+        I2CQueue_NextOp();
+    }
+}
+
+/**
+  * @brief  I2C error callback
+  * @param  hi2c: I2C handle
+  * @retval None
+  *
+  * The rest of the active job is dropped. The TCA9548A selection is no longer known, so the next job
+  * writes it again.
+  */
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c->Instance == I2C1 && active_job != NULL)
+    {
+        i2c_errors++;
+        dbh_TCA9548A_Invalidate();
+        I2CQueue_Finish(I2C_QUEUE_STATUS_ERROR);
+    }
+}
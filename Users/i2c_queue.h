@@ -0,0 +1,61 @@
+/**
+  ******************************************************************************
+  * @file    i2c_queue.h
+  * @brief   This file contains the type definitions and function prototypes
+  *          for the i2c_queue.c file.
+  * @author  doublehan07
+  * @version V1.0
+  * @date    2026-10-17
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __I2C_QUEUE_H
+#define __I2C_QUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported macro ------------------------------------------------------------*/
+// Operation types
+#define I2C_OP_WRITE              0 // Write data to the register
+#define I2C_OP_READ               1 // Read the register into data
+
+// Job status
+#define I2C_QUEUE_STATUS_DONE     0 // Finished, or never submitted
+#define I2C_QUEUE_STATUS_QUEUED   1 // Waiting for the bus
+#define I2C_QUEUE_STATUS_BUSY     2 // On the bus
+#define I2C_QUEUE_STATUS_ERROR    3 // Finished, but an operation was not acknowledged
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint8_t type;     /*!< Specifies the operation, I2C_OP_WRITE or I2C_OP_READ */
+  uint8_t reg;      /*!< Specifies the register address */
+  uint8_t data;     /*!< Specifies the data to write, or receives the data read */
+} I2C_OP_TypeDef;
+
+typedef struct I2C_JOB
+{
+  struct I2C_JOB *next;                     /*!< Used by the queue, don't touch */
+  uint16_t address;                         /*!< Specifies the device address, the LSB is the R/W bit */
+  uint8_t mux_mask;                         /*!< Specifies the TCA9548A channels opened before the operations */
+  uint8_t op_count;                         /*!< Specifies the number of operations */
+  I2C_OP_TypeDef *ops;                      /*!< Specifies the register operations, run in order */
+  void (*callback)(struct I2C_JOB *job);    /*!< Called in interrupt context when the job is finished, may be NULL */
+  __IO uint8_t status;                      /*!< Specifies the status of the job */
+} I2C_JOB_TypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+void dbh_I2CQueue_Submit(I2C_JOB_TypeDef *job);
+uint8_t dbh_I2CQueue_IsIdle(I2C_JOB_TypeDef *job);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __I2C_QUEUE_H */
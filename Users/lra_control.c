@@ -10,79 +10,411 @@
 
 #include "lra_control.h"
 #include "usart.h"
+#include "telemetry.h"
+#include "drv2605l.h"
+#include "ads1256.h"
+#include "delay.h"
+#include "histogram.h"
+
+#define LRA_RX_RING_SIZE          512 // The DMA ring of the host commands, 5.5 ms of line time at 921600 baud, a power of 2
+#define LRA_FRAME_SIZE            7 // Header (2) | Channel | Waveform Number | Duration_H | Duration_L | CRC
+#define LRA_FRAME_MAX_SIZE        (5 + 3 * 8) // Header (2) | LRA_CMD_MULTI_CHANNEL | Mask | 8 x (Waveform Number | Duration_H | Duration_L) | CRC
+#define LRA_RTP_FRAME_SIZE(mask)  (5 + LRA_BitCount(mask)) // Header (2) | LRA_CMD_RTP | Mask | Amplitude per channel | CRC
+#define LRA_EVENT_FRAME_SIZE      10 // Header (2) | LRA_CMD_SCHEDULED | Channel | Waveform Number | Duration_H | Duration_L | Timestamp_H | Timestamp_L | CRC
+#define LRA_PRIORITY_FRAME_SIZE   9 // Header (2) | LRA_CMD_PRIORITY | Channel | Priority | Waveform Number | Duration_H | Duration_L | CRC
+
+#define LRA_IS_STOP(wave)         ((wave) == 0 || (wave) > 123) // The waveform numbers that stop a channel
+#define LRA_PRIORITY_STOP         0xFF // A stop is accepted whatever the priority of the effect it ends
+#define LRA_PRIORITY_OF(wave, prio) (LRA_IS_STOP(wave) ? LRA_PRIORITY_STOP : (prio)) // The priority a command is accepted with
+
+#if (LRA_RX_RING_SIZE & (LRA_RX_RING_SIZE - 1)) != 0
+#error "LRA_RX_RING_SIZE must be a power of 2, the byte counts wrap around the ring"
+#endif
 
 __IO uint8_t current_channel = 0;
 __IO uint8_t wave_num[8] = {0};
 __IO uint16_t duration[8] = {0};
 __IO uint16_t lra_counter[8] = {0};
-__IO uint16_t current_timestamp = 0;
-uint8_t rx_data[10] = {0};
+__IO uint8_t priority[8] = {0}; // The priority of the effect of every channel, LRA_PRIORITY_LOWEST when idle
+__IO uint16_t priority_counter[8] = {0}; // The ms left before the effect of every channel falls back to LRA_PRIORITY_LOWEST
+__IO uint8_t preempted = 0; // The channels whose next play must cancel the effect still playing
+__IO uint8_t rtp_amplitude[8] = {0}; // The latest RTP amplitude of every channel
+__IO uint8_t rtp_mask = 0; // The channels driven in RTP mode instead of by waveforms
+__IO uint8_t rtp_update = 0; // The channels whose RTP amplitude was not written to the DRV2605L yet
+LRA_EVENT_TypeDef event_queue[LRA_EVENT_QUEUE_SIZE] = {0}; // Scheduled haptic events, filled by the parser and fired by dbh_LRA_Control_TickEvents()
+__IO uint32_t event_overflows = 0; // Scheduled events dropped because the queue was full
+uint8_t rx_ring[LRA_RX_RING_SIZE] = {0}; // Written by the circular DMA
+__IO uint32_t rx_written = 0; // The bytes written by the DMA since the reception started, updated on IDLE, half and full transfer
+uint16_t rx_dma_pos = 0; // The position the DMA writes next, as of the last receive event
+uint32_t rx_read = 0; // The bytes read by the parser, rx_read % LRA_RX_RING_SIZE is the position it reads next
+__IO uint32_t rx_overflows = 0; // Times the DMA lapped the parser, the unread bytes were dropped
+uint8_t rx_frame[LRA_FRAME_MAX_SIZE] = {0}; // The command being assembled
+uint8_t rx_frame_len = 0;
+uint8_t rx_frame_size = LRA_FRAME_SIZE; // The expected size of the command being assembled
+__IO uint32_t rx_crc_errors = 0; // Frames with a correct header and a wrong CRC
+__IO uint32_t rx_time = 0; // The dbh_GetMicros() time of the last UART receive event
+__IO uint32_t command_time[8] = {0}; // The time the last command of every channel was received
+__IO uint8_t latency_pending[8] = {0}; // Set while the last command of the channel did not reach the DRV2605L, one byte each so the interrupts can clear them
 
 /**
   * @brief  Initialize the LRA control
   * @retval None
   *
-  * This function initializes the LRA control by setting up the UART to receive data.
+  * This function initializes the LRA control by setting up the UART to receive data into the DMA ring.
   */
 void dbh_LRA_Control_Init(void)
 {
-    HAL_UARTEx_ReceiveToIdle_IT(&huart1, rx_data, 10);
+    rx_written = 0;
+    rx_dma_pos = 0;
+    rx_read = 0;
+    rx_frame_len = 0;
+    rx_frame_size = LRA_FRAME_SIZE;
+    HAL_UARTEx_ReceiveToIdle_DMA(&huart1, rx_ring, LRA_RX_RING_SIZE);
 }
 
 /**
   * @brief  UART receive event callback
   * @param  huart: UART handle
-  * @param  Size: Size of the received data
+  * @param  Size: the position in the ring the DMA reached
   * @retval None
   *
-  * This function is called when the UART receives data. It processes the received data and updates the LRA control parameters.
+  * This function is called on the IDLE line and when the DMA reaches the half or the end of the ring.
+  * It only counts the bytes written since the last event, the commands are parsed by dbh_LRA_Control_Process().
+  * The half and full transfer events make sure the DMA never moves a whole ring between two events.
   */
 void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
 {
-    uint8_t checksum = 0;
-    uint8_t i = 0;
+    if (huart->Instance == USART1)
+    {
+        rx_written += (Size + LRA_RX_RING_SIZE - rx_dma_pos) % LRA_RX_RING_SIZE;
+        rx_dma_pos = Size % LRA_RX_RING_SIZE;
+        rx_time = dbh_GetMicros();
+    }
+}
 
+/**
+  * @brief  UART error callback
+  * @param  huart: UART handle
+  * @retval None
+  *
+  * The HAL stops the reception on an overrun or framing error, restart the ring.
+  */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
     if (huart->Instance == USART1)
     {
-        // Process the received data
-        // Header (0x55) | Header (0xAA) | Channel(0-7) X | Waveform Number X | Duration_H X | Dutation_L X | CRC 
+        dbh_LRA_Control_Init();
+    }
+}
+
+/**
+  * @brief  Count the bits set in a channel mask
+  * @param  mask: the channel mask
+  * @retval the number of channels in the mask
+  */
+static uint8_t LRA_BitCount(uint8_t mask)
+{
+    uint8_t count = 0;
+
+    while (mask)
+    {
+        count += mask & 0x01;
+        mask >>= 1;
+    }
+
+    return count;
+}
+
+/**
+  * @brief  Start the command-to-actuation measurement of a channel
+  * @param  channel: The channel number (0-7)
+  * @param  since: the dbh_GetMicros() time the command arrived
+  * @retval None
+  *
+  * The measurement ends in dbh_DRV2605L_ActuatedCallback(), when the writes of the command went through.
+  */
+static void LRA_StartLatency(uint8_t channel, uint32_t since)
+{
+    command_time[channel] = since;
+    latency_pending[channel] = 1;
+}
+
+/**
+  * @brief  Check if a command may take over a channel
+  * @param  channel: The channel number (0-7)
+  * @param  prio: the priority of the command, see LRA_PRIORITY_OF()
+  * @retval 1 if the channel is idle or plays an effect of the same or a lower priority, 0 otherwise
+  *
+  * The priority of a waveform only holds for its duration, so a looping effect doesn't lock out the
+  * commands of a lower priority forever. An RTP stream holds its priority until it is stopped.
+  */
+static uint8_t LRA_Accept(uint8_t channel, uint8_t prio)
+{
+    uint8_t current = LRA_PRIORITY_LOWEST;
+
+    if (channel >= 5)
+    {
+        return 0;
+    }
+
+    if (priority_counter[channel] || (rtp_mask & (1 << channel)))
+    {
+        current = priority[channel];
+    }
+
+    return prio >= current;
+}
+
+/**
+  * @brief  Start a waveform on a channel, cancelling the effect it plays
+  * @param  channel: The channel number (0-4), accepted by LRA_Accept()
+  * @param  wave: the waveform number, 0 or above 123 stops the channel
+  * @param  time: the duration of the waveform in ms
+  * @param  prio: the priority of the command
+  * @retval None
+  *
+  * A command repeating the waveform and priority of the channel only updates the duration, so a host
+  * streaming the same command doesn't restart the effect on every packet.
+  */
+static void LRA_SetWaveform(uint8_t channel, uint8_t wave, uint16_t time, uint8_t prio)
+{
+    prio = LRA_IS_STOP(wave) ? LRA_PRIORITY_LOWEST : prio; // A stopped channel takes any command
+
+    if (wave == wave_num[channel] && prio == priority[channel] && !(rtp_mask & (1 << channel)))
+    {
+        duration[channel] = time;
+        priority_counter[channel] = LRA_IS_STOP(wave) ? 0 : time;
+        return;
+    }
+
+    wave_num[channel] = wave;
+    duration[channel] = time;
+    lra_counter[channel] = 0; // Play in the next haptic slot instead of after the current effect
+    rtp_mask &= ~(1 << channel); // Back to the waveforms
+    preempted |= 1 << channel;
+    priority[channel] = prio;
+    priority_counter[channel] = LRA_IS_STOP(wave) ? 0 : time;
+
+    if (wave > 0 && wave < 124)
+    {
+        LRA_StartLatency(channel, rx_time);
+    }
+    else
+    {
+        latency_pending[channel] = 0; // A stop is not an actuation
+    }
+}
 
-        // Check the header
-        if (rx_data[0] != 0x55 || rx_data[1] != 0xAA)
+/**
+  * @brief  Execute a host command
+  * @param  frame: a command with a correct header and CRC
+  * @retval None
+  */
+static void LRA_Execute(const uint8_t *frame)
+{
+    uint8_t i = 0;
+    const uint8_t *entry = &frame[4];
+
+    if (frame[2] == LRA_CMD_TELEMETRY_FORMAT) // A host command instead of a channel
+    {
+        dbh_Telemetry_SetFormat(frame[3]);
+    }
+    else if (frame[2] == LRA_CMD_FRAME_PERIOD)
+    {
+        dbh_ADS1256_SetFramePeriod(frame[3] * 100);
+    }
+    else if (frame[2] == LRA_CMD_PROFILE)
+    {
+        dbh_Telemetry_RequestProfile();
+    }
+    else if (frame[2] == LRA_CMD_SCAN_MODE)
+    {
+        dbh_ADS1256_SetMode(frame[3] == ADS1256_MODE_SIMULTANEOUS ? ADS1256_MODE_SIMULTANEOUS : ADS1256_MODE_OVERLAPPED);
+    }
+    else if (frame[2] == LRA_CMD_RECALIBRATE)
+    {
+        // The Auto-Calibration needs the blocking I2C accesses of the boot, so reboot instead of calibrating here
+        dbh_DRV2605L_ForgetCalibration();
+        NVIC_SystemReset();
+    }
+    else if (frame[2] == LRA_CMD_SCHEDULED) // Queue the event for its timestamp
+    {
+        for (i = 0; i < LRA_EVENT_QUEUE_SIZE && event_queue[i].used; i++);
+
+        if (i == LRA_EVENT_QUEUE_SIZE)
         {
-            //The header is not correct, discard the data
+            event_overflows++;
         }
-        else // The header is correct
+        else if (frame[3] < 5) // The channel is valid
         {
-            // Check the CRC
-            for (i = 2; i < 6; i++)
-            {
-                checksum += rx_data[i];
-            }
-
-            if (checksum != rx_data[6])
+            event_queue[i].channel = frame[3];
+            event_queue[i].wave = frame[4];
+            event_queue[i].duration = (frame[5] << 8) | frame[6];
+            event_queue[i].timestamp = (frame[7] << 8) | frame[8];
+            event_queue[i].used = 1; // Written last, the timer interrupt may read the entry from now on
+        }
+    }
+    else if (frame[2] == LRA_CMD_MULTI_CHANNEL) // Update every channel of the mask at once
+    {
+        for (i = 0; i < 8; i++)
+        {
+            if (frame[3] & (1 << i))
             {
-                //The CRC is not correct, discard the data
+                if (LRA_Accept(i, LRA_PRIORITY_OF(entry[0], LRA_PRIORITY_NORMAL))) // The channel is valid and not busy with a higher priority effect
+                {
+                    LRA_SetWaveform(i, entry[0], (entry[1] << 8) | entry[2], LRA_PRIORITY_NORMAL);
+                }
+                entry += 3;
             }
-            else // The CRC is correct
+        }
+    }
+    else if (frame[2] == LRA_CMD_RTP) // Stream the amplitudes of every channel of the mask
+    {
+        for (i = 0; i < 8; i++)
+        {
+            if (frame[3] & (1 << i))
             {
-                current_channel = rx_data[2];
-                if (current_channel < 5) // The channel is valid
+                if (LRA_Accept(i, LRA_PRIORITY_NORMAL)) // The channel is valid and not busy with a higher priority effect
                 {
-                    wave_num[current_channel] = rx_data[3];
-                    duration[current_channel] = (rx_data[4] << 8) | rx_data[5];
-                    lra_counter[current_channel] = 0;
+                    wave_num[i] = 0; // No waveform while in RTP mode
+                    rtp_amplitude[i] = entry[0];
+                    rtp_mask |= 1 << i;
+                    rtp_update |= 1 << i;
+                    priority[i] = LRA_PRIORITY_NORMAL;
+                    LRA_StartLatency(i, rx_time);
                 }
+                entry += 1;
             }
         }
+    }
+    else if (frame[2] == LRA_CMD_PRIORITY) // A single channel command with a priority
+    {
+        if (LRA_Accept(frame[3], LRA_PRIORITY_OF(frame[5], frame[4])))
+        {
+            current_channel = frame[3];
+            LRA_SetWaveform(current_channel, frame[5], (frame[6] << 8) | frame[7], frame[4]);
+        }
+    }
+    else
+    {
+        if (LRA_Accept(frame[2], LRA_PRIORITY_OF(frame[3], LRA_PRIORITY_NORMAL))) // The channel is valid and not busy with a higher priority effect
+        {
+            current_channel = frame[2];
+            LRA_SetWaveform(current_channel, frame[3], (frame[4] << 8) | frame[5], LRA_PRIORITY_NORMAL);
+        }
+    }
+}
+
+/**
+  * @brief  Feed one received byte to the command parser
+  * @param  byte: the received byte
+  * @retval the number of bytes to parse again, 0 in most cases
+  *
+  * The parser looks for the 0x55 0xAA header, collects the rest of the command and checks the CRC.
+  * After a wrong CRC, the bytes behind the false header must be parsed again, so a real header among
+  * them is not lost.
+  */
+static uint8_t LRA_ParseByte(uint8_t byte)
+{
+    // Header (0x55) | Header (0xAA) | Channel(0-7) X | Waveform Number X | Duration_H X | Dutation_L X | CRC
+    // A channel byte of 0x80 or above is a host command, see LRA_CMD_*, the waveform number byte is its argument
+    // Header (0x55) | Header (0xAA) | LRA_CMD_MULTI_CHANNEL | Mask | Waveform Number X | Duration_H X | Dutation_L X | ... | CRC
+    // The multi-channel command carries one entry per bit set in the mask, lowest channel first
+    // Header (0x55) | Header (0xAA) | LRA_CMD_RTP | Mask | Amplitude X | ... | CRC
+    // Header (0x55) | Header (0xAA) | LRA_CMD_SCHEDULED | Channel | Waveform Number | Duration_H | Duration_L | Timestamp_H | Timestamp_L | CRC
+    // Header (0x55) | Header (0xAA) | LRA_CMD_PRIORITY | Channel | Priority | Waveform Number | Duration_H | Duration_L | CRC
+    uint8_t checksum = 0;
+    uint8_t i = 0;
+
+    rx_frame[rx_frame_len++] = byte;
+
+    if (rx_frame_len == 1 && byte != 0x55)
+    {
+        rx_frame_len = 0; // Not a header, discard the byte
+    }
+    else if (rx_frame_len == 2 && byte != 0xAA)
+    {
+        rx_frame_len = 0;
+        if (byte == 0x55) // The byte can start the next header
+        {
+            rx_frame[rx_frame_len++] = byte;
+        }
+    }
+    else if (rx_frame_len == 4)
+    {
+        rx_frame_size = LRA_FRAME_SIZE;
+        if (rx_frame[2] == LRA_CMD_MULTI_CHANNEL)
+        {
+            rx_frame_size = 5 + 3 * LRA_BitCount(byte);
+        }
+        else if (rx_frame[2] == LRA_CMD_RTP)
+        {
+            rx_frame_size = LRA_RTP_FRAME_SIZE(byte);
+        }
+        else if (rx_frame[2] == LRA_CMD_SCHEDULED)
+        {
+            rx_frame_size = LRA_EVENT_FRAME_SIZE;
+        }
+        else if (rx_frame[2] == LRA_CMD_PRIORITY)
+        {
+            rx_frame_size = LRA_PRIORITY_FRAME_SIZE;
+        }
+    }
 
-        //Reset the uart buffer
-        HAL_UARTEx_ReceiveToIdle_IT(&huart1, rx_data, 10);
-        if (huart1.RxXferCount < huart1.RxXferSize) // If the buffer is not empty, discard the data
+    if (rx_frame_len >= 4 && rx_frame_len == rx_frame_size)
+    {
+        rx_frame_len = 0;
+
+        // Check the CRC
+        for (i = 2; i < rx_frame_size - 1; i++)
         {
-            huart1.RxXferCount = huart1.RxXferSize;
-            huart1.pRxBuffPtr = rx_data;
+            checksum += rx_frame[i];
         }
+
+        if (checksum == rx_frame[rx_frame_size - 1]) // The CRC is correct
+        {
+            LRA_Execute(rx_frame);
+        }
+        else // The CRC is not correct, resynchronise on the bytes after the header
+        {
+            rx_crc_errors++;
+            return rx_frame_size - 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+  * @brief  Process the host commands received since the last call
+  * @retval None
+  *
+  * This function should be called from the main loop. Any number of commands per burst is handled,
+  * as long as the ring is drained before the DMA laps it. If the DMA lapped the parser, the unread
+  * bytes are overwritten: they are dropped, counted in rx_overflows, and the parser waits for the
+  * next header. The commands update the same channel state as dbh_LRA_Control_TickEvents(), so the
+  * TIM14 interrupt must be disabled around this function.
+  */
+void dbh_LRA_Control_Process(void)
+{
+    uint32_t written = rx_written;
+    uint8_t replay = 0;
+
+    if (written - rx_read > LRA_RX_RING_SIZE) // The DMA overwrote bytes the parser did not read
+    {
+        rx_overflows++;
+        rx_read = written;
+        rx_frame_len = 0;
+        return;
+    }
+
+    while (rx_read != written)
+    {
+        replay = LRA_ParseByte(rx_ring[rx_read % LRA_RX_RING_SIZE]);
+        rx_read++;
+
+        // The dropped bytes are still in the ring, step back to the byte after the false header
+        rx_read -= replay;
     }
 }
 
@@ -135,20 +467,21 @@ void dbh_ResetCounter(uint8_t channel)
 
 /**
   * @brief  Decrement the counters for all channels
+  * @param  elapsed: the ms since the last call
   * @retval None
   *
-  * This function decrements the counters for all channels. If the counter reaches zero, it stops the LRA.
+  * This function decrements the counters for all channels. When a counter reaches zero, the waveform of the
+  * channel is played again. It is called from the haptics task, which may run late, so it takes the elapsed time.
+  * The priority of an effect expires the same way.
   */
-void dbh_DecCounter(void)
+void dbh_DecCounter(uint16_t elapsed)
 {
     uint8_t i = 0;
 
     for (i = 0; i < 8; i++)
     {
-        if (lra_counter[i] > 0)
-        {
-            lra_counter[i]--;
-        }
+        lra_counter[i] = lra_counter[i] > elapsed ? lra_counter[i] - elapsed : 0;
+        priority_counter[i] = priority_counter[i] > elapsed ? priority_counter[i] - elapsed : 0;
     }
 }
 
@@ -165,17 +498,120 @@ uint16_t dbh_GetCounter(uint8_t channel)
 }
 
 /**
-  * @brief  Increment the timestamp
+  * @brief  Check if the next play of a channel must cancel the effect still playing
+  * @param  channel: The channel number (0-7)
+  * @retval 1 if a new command took over the channel since its last play, 0 otherwise
+  */
+uint8_t dbh_IsPreempted(uint8_t channel)
+{
+    return (preempted >> channel) & 0x01;
+}
+
+/**
+  * @brief  Mark the preempting command of a channel as played
+  * @param  channel: The channel number (0-7)
+  * @retval None
+  */
+void dbh_ClearPreempted(uint8_t channel)
+{
+    preempted &= ~(1 << channel);
+}
+
+/**
+  * @brief  Check if a channel is driven in RTP mode
+  * @param  channel: The channel number (0-7)
+  * @retval 1 if the channel follows the RTP amplitude stream, 0 if it plays waveforms
+  */
+uint8_t dbh_IsRTP(uint8_t channel)
+{
+    return (rtp_mask >> channel) & 0x01;
+}
+
+/**
+  * @brief  Get the RTP amplitude of a channel if it changed
+  * @param  channel: The channel number (0-7)
+  * @param  amplitude: receives the latest amplitude
+  * @retval 1 if the amplitude was not written to the DRV2605L yet, 0 otherwise
+  */
+uint8_t dbh_GetRTPUpdate(uint8_t channel, uint8_t *amplitude)
+{
+    *amplitude = rtp_amplitude[channel];
+    return (rtp_update >> channel) & 0x01;
+}
+
+/**
+  * @brief  Mark the RTP amplitude of a channel as written
+  * @param  channel: The channel number (0-7)
+  * @retval None
+  */
+void dbh_ClearRTPUpdate(uint8_t channel)
+{
+    rtp_update &= ~(1 << channel);
+}
+
+/**
+  * @brief  Fire the scheduled haptic events that are due
+  * @retval None
+  *
+  * This function should be called every 1 ms from the haptic event timer interrupt. An event fires at the
+  * first tick where dbh_GetTimestamp() has reached its timestamp, so the host must schedule it less than
+  * 32 s ahead. The waveform is queued on the I2C bus right away instead of waiting for the main loop, which
+  * masks the timer interrupt while it drives the haptics itself.
+  */
+void dbh_LRA_Control_TickEvents(void)
+{
+    uint8_t i = 0;
+    LRA_EVENT_TypeDef *event = NULL;
+
+    for (i = 0; i < LRA_EVENT_QUEUE_SIZE; i++)
+    {
+        event = &event_queue[i];
+        if (!event->used || (int16_t)(dbh_GetTimestamp() - event->timestamp) < 0) // Empty, or in the future
+        {
+            continue;
+        }
+
+        event->used = 0;
+        if (!LRA_Accept(event->channel, LRA_PRIORITY_OF(event->wave, LRA_PRIORITY_NORMAL))) // Busy with a higher priority effect
+        {
+            continue;
+        }
+
+        LRA_SetWaveform(event->channel, event->wave, event->duration, LRA_PRIORITY_NORMAL);
+        command_time[event->channel] = dbh_GetMicros(); // Measured from the due time instead of the reception
+
+        if (dbh_DRV2605L_GetStage() == DRV2605L_STAGE_READY)
+        {
+            if (event->wave > 0 && event->wave < 124)
+            {
+                if (dbh_DRV2605L_PlayWaveform(event->channel, event->wave, 1)) // Else played by the main loop
+                {
+                    dbh_ResetCounter(event->channel);
+                    preempted &= ~(1 << event->channel);
+                }
+            }
+            else
+            {
+                dbh_DRV2605L_StopWaveform(event->channel);
+            }
+        }
+    }
+}
+
+/**
+  * @brief  DRV2605L actuation callback
+  * @param  device: the DRV2605L device, the same number as its channel
   * @retval None
   *
-  * This function increments the timestamp. If it exceeds 65535, it wraps around to 0.
+  * This function is called in interrupt context. Only the first actuation after a command is counted,
+  * the repeats of a waveform are not commands.
   */
-void dbh_IncTimestampInMS(void)
+void dbh_DRV2605L_ActuatedCallback(uint8_t device)
 {
-    current_timestamp++;
-    if (current_timestamp > 65535)
+    if (latency_pending[device])
     {
-        current_timestamp = 0;
+        latency_pending[device] = 0;
+        dbh_Histogram_Add(HISTOGRAM_COMMAND_LATENCY, dbh_GetMicros() - command_time[device]);
     }
 }
 
@@ -183,9 +619,10 @@ void dbh_IncTimestampInMS(void)
   * @brief  Get the current timestamp
   * @retval The current timestamp
   *
-  * This function returns the current timestamp.
+  * This function returns the ms since power up, wrapping around from 65535 to 0. It follows the HAL tick,
+  * so it needs no work in the SysTick interrupt.
   */
 uint16_t dbh_GetTimestamp(void)
 {
-    return current_timestamp;
+    return (uint16_t)HAL_GetTick();
 }
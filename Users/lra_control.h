@@ -19,17 +19,51 @@ extern "C" {
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
 
+/* Exported macro ------------------------------------------------------------*/
+// Host commands, sent in the channel byte of the host frame
+#define LRA_CMD_TELEMETRY_FORMAT  0xF0 // Select the telemetry wire format, argument TELEMETRY_FORMAT_V1 or TELEMETRY_FORMAT_V2
+#define LRA_CMD_MULTI_CHANNEL     0xF1 // Update several channels at once, argument the channel mask, followed by one entry per channel
+#define LRA_CMD_RTP               0xF2 // Stream RTP amplitudes, argument the channel mask, followed by one amplitude byte per channel
+#define LRA_CMD_RECALIBRATE       0xF3 // Forget the saved DRV2605L calibration and reboot to calibrate again, argument ignored
+#define LRA_CMD_SCHEDULED         0xF4 // Play a waveform at a device timestamp, followed by a single channel entry and the timestamp
+#define LRA_CMD_PRIORITY          0xF5 // Play a waveform with a priority, argument the channel, followed by the priority and a single channel entry
+#define LRA_CMD_FRAME_PERIOD      0xF6 // Select the ADS1256 frame period, argument the period in 100 us steps, 0 for free running
+#define LRA_CMD_PROFILE           0xF7 // Send the per-stage timing as a profile frame and start a new measurement window, argument ignored
+#define LRA_CMD_SCAN_MODE         0xF8 // Select the ADS1256 scan mode, argument ADS1256_MODE_OVERLAPPED or ADS1256_MODE_SIMULTANEOUS
+
+// Command priorities, a command is ignored while its channel plays an effect of a higher priority
+#define LRA_PRIORITY_LOWEST       0x00 // The priority of an idle channel
+#define LRA_PRIORITY_NORMAL       0x80 // The priority of the commands without a priority field
+
+#define LRA_EVENT_QUEUE_SIZE      8 // Scheduled haptic events waiting for their timestamp
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint16_t timestamp;         /*!< Specifies the dbh_GetTimestamp() value the event fires at */
+  uint16_t duration;          /*!< Specifies the duration of the waveform, as in a single channel command */
+  uint8_t channel;            /*!< Specifies the channel of the event */
+  uint8_t wave;               /*!< Specifies the waveform number, 0 stops the channel */
+  __IO uint8_t used;          /*!< Specifies whether the entry holds an event, written last by the parser and cleared when fired */
+} LRA_EVENT_TypeDef;
+
 /* Exported functions ------------------------------------------------------- */
 void dbh_LRA_Control_Init(void);
+void dbh_LRA_Control_Process(void);
 
 uint8_t dbh_GetChannel(void);
 uint8_t dbh_GetWaveNum(uint8_t channel);
 uint16_t dbh_GetDuration(uint8_t channel);
 void dbh_ResetCounter(uint8_t channel);
-void dbh_DecCounter(void);
+void dbh_DecCounter(uint16_t elapsed);
 uint16_t dbh_GetCounter(uint8_t channel);
+uint8_t dbh_IsPreempted(uint8_t channel);
+void dbh_ClearPreempted(uint8_t channel);
+uint8_t dbh_IsRTP(uint8_t channel);
+uint8_t dbh_GetRTPUpdate(uint8_t channel, uint8_t *amplitude);
+void dbh_ClearRTPUpdate(uint8_t channel);
+void dbh_LRA_Control_TickEvents(void);
 
-void dbh_IncTimestampInMS(void);
 uint16_t dbh_GetTimestamp(void);
 
 #ifdef __cplusplus
@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file    profiler.c
+  * @brief   This file contains the functions to collect the per-stage timing of the hot paths
+  * @author  doublehan07
+  * @version V1.0
+  * @date    2026-10-17
+  ******************************************************************************
+  */
+
+#include "profiler.h"
+
+// The statistics since the last fetch, min starts at 0xFFFFFFFF so the first measurement replaces it
+PROFILER_STAGE_TypeDef profiler_stages[PROFILER_STAGE_NUM] = {
+    {0, 0xFFFFFFFF, 0, 0}, {0, 0xFFFFFFFF, 0, 0}, {0, 0xFFFFFFFF, 0, 0},
+    {0, 0xFFFFFFFF, 0, 0}, {0, 0xFFFFFFFF, 0, 0}, {0, 0xFFFFFFFF, 0, 0},
+};
+
+/**
+  * @brief  Add a measurement to the statistics of a stage
+  * @param  stage: the stage, see PROFILER_STAGE_*
+  * @param  cycles: the CPU cycles spent in the stage
+  * @retval None
+  *
+  * This function is called through PROFILER_STOP(), from the main loop and from the interrupts.
+  */
+void dbh_Profiler_Record(uint8_t stage, uint32_t cycles)
+{
+    PROFILER_STAGE_TypeDef *s = &profiler_stages[stage];
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    s->count++;
+    s->sum += cycles;
+    if (cycles < s->min)
+    {
+        s->min = cycles;
+    }
+    if (cycles > s->max)
+    {
+        s->max = cycles;
+    }
+    __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Copy the statistics of a stage and start a new measurement window
+  * @param  stage: the stage, see PROFILER_STAGE_*
+  * @param  stats: receives the statistics since the last fetch
+  * @retval None
+  */
+void dbh_Profiler_Fetch(uint8_t stage, PROFILER_STAGE_TypeDef *stats)
+{
+    PROFILER_STAGE_TypeDef *s = &profiler_stages[stage];
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    *stats = *s;
+    s->count = 0;
+    s->sum = 0;
+    s->min = 0xFFFFFFFF;
+    s->max = 0;
+    __set_PRIMASK(primask);
+}
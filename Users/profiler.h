@@ -0,0 +1,62 @@
+/**
+  ******************************************************************************
+  * @file    profiler.h
+  * @brief   This file contains the instrumentation macros, type definitions and
+  *          function prototypes for the profiler.c file.
+  * @author  doublehan07
+  * @version V1.0
+  * @date    2026-10-17
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PROFILER_H
+#define __PROFILER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "delay.h"
+
+/* Exported macro ------------------------------------------------------------*/
+#define PROFILER_ENABLED          1 // Set to 0 to compile the instrumentation out of the hot paths
+
+// Profiled stages, all timed in CPU cycles
+#define PROFILER_STAGE_TCA_SELECT 0 // TCA9548A control register write on the I2C bus
+#define PROFILER_STAGE_DRV_JOB    1 // DRV2605L register operations of a job on the I2C bus, after the select
+#define PROFILER_STAGE_ADS_SCAN   2 // ADS1256 scan, from queueing the multiplexer cycles to the finished frame
+#define PROFILER_STAGE_FSR_ADC    3 // dbh_FSR_GetADCValue()
+#define PROFILER_STAGE_CHECKSUM   4 // Checksum of a telemetry frame
+#define PROFILER_STAGE_UART_TX    5 // Telemetry frame on the UART, from the DMA start to the TX complete callback
+#define PROFILER_STAGE_NUM        6
+
+// Instrumentation, start is a uint32_t variable of the caller that lives until the matching PROFILER_STOP()
+#if PROFILER_ENABLED
+#define PROFILER_START(start)        ((start) = dbh_GetCycles())
+#define PROFILER_STOP(stage, start)  dbh_Profiler_Record((stage), dbh_GetCycles() - (start))
+#else
+#define PROFILER_START(start)        ((void)(start))
+#define PROFILER_STOP(stage, start)  ((void)(start))
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t count; /*!< Specifies the number of measurements */
+  uint32_t min;   /*!< Specifies the shortest measurement in CPU cycles, 0xFFFFFFFF if none */
+  uint32_t max;   /*!< Specifies the longest measurement in CPU cycles */
+  uint64_t sum;   /*!< Specifies the sum of the measurements, for the mean */
+} PROFILER_STAGE_TypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+void dbh_Profiler_Record(uint8_t stage, uint32_t cycles);
+void dbh_Profiler_Fetch(uint8_t stage, PROFILER_STAGE_TypeDef *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PROFILER_H */
@@ -0,0 +1,149 @@
+/**
+  ******************************************************************************
+  * @file    scheduler.c
+  * @brief   This file contains the cooperative task scheduler of the main loop
+  * @author  doublehan07
+  * @version V1.0
+  * @date    2026-10-17
+  ******************************************************************************
+  */
+
+#include "scheduler.h"
+#include "delay.h"
+
+SCHEDULER_TASK_TypeDef tasks[SCHEDULER_TASK_MAX] = {0}; // The registered tasks, sorted by priority
+uint8_t task_num = 0; // The number of registered tasks
+__IO uint32_t scheduler_ticks = 0; // The ms ticks posted by the SysTick interrupt
+uint32_t scheduler_pass = 0; // The number of scheduler passes, to run each poll task once per pass
+
+/**
+  * @brief  Register a task
+  * @param  run: the task function
+  * @param  period: the release period in ms, or SCHEDULER_POLL to run the task once per pass
+  * @param  deadline: the time in ms after its release by which the task must be done
+  * @param  priority: 0 is the highest, tasks of the same priority run in registration order
+  * @retval the task, to read its counters in the debugger, or NULL if the table is full
+  *
+  * All tasks must be registered before dbh_Scheduler_Run() is called.
+  */
+SCHEDULER_TASK_TypeDef *dbh_Scheduler_AddTask(void (*run)(void), uint16_t period, uint16_t deadline, uint8_t priority)
+{
+    uint8_t i = task_num;
+
+    if (task_num >= SCHEDULER_TASK_MAX)
+    {
+        return NULL;
+    }
+
+    // Insertion sort, so the scheduler can take the first released task
+    while (i > 0 && tasks[i - 1].priority > priority)
+    {
+        tasks[i] = tasks[i - 1];
+        i--;
+    }
+
+    tasks[i].run = run;
+    tasks[i].period = period;
+    tasks[i].deadline = deadline;
+    tasks[i].priority = priority;
+    tasks[i].release = period == SCHEDULER_POLL ? 0 : scheduler_ticks;
+    tasks[i].runs = 0;
+    tasks[i].overruns = 0;
+    tasks[i].last_cycles = 0;
+    tasks[i].max_cycles = 0;
+    task_num++;
+
+    return &tasks[i];
+}
+
+/**
+  * @brief  Post a tick to the scheduler
+  * @retval None
+  *
+  * This function should be called every 1 ms in the SysTick interrupt function. It is the only work
+  * of the scheduler in interrupt context.
+  */
+void dbh_Scheduler_Tick(void)
+{
+    scheduler_ticks++;
+}
+
+/**
+  * @brief  Get the ticks posted to the scheduler
+  * @retval the number of ms since the SysTick was started
+  */
+uint32_t dbh_Scheduler_GetTicks(void)
+{
+    return scheduler_ticks;
+}
+
+/**
+  * @brief  Run the highest priority task that is released
+  * @retval 1 if a task was run, 0 if no task is released
+  */
+static uint8_t Scheduler_RunNext(void)
+{
+    uint8_t i = 0;
+    uint32_t now = scheduler_ticks;
+    uint32_t start = 0;
+    SCHEDULER_TASK_TypeDef *task = NULL;
+
+    for (i = 0; i < task_num && task == NULL; i++)
+    {
+        if (tasks[i].period == SCHEDULER_POLL ? tasks[i].release != scheduler_pass : (int32_t)(now - tasks[i].release) >= 0)
+        {
+            task = &tasks[i];
+        }
+    }
+
+    if (task == NULL)
+    {
+        return 0;
+    }
+
+    start = dbh_GetCycles();
+    task->run();
+    task->last_cycles = dbh_GetCycles() - start;
+    if (task->last_cycles > task->max_cycles)
+    {
+        task->max_cycles = task->last_cycles;
+    }
+    task->runs++;
+
+    if (task->period == SCHEDULER_POLL)
+    {
+        task->release = scheduler_pass;
+        return 1;
+    }
+
+    if (scheduler_ticks - task->release > task->deadline)
+    {
+        task->overruns++;
+    }
+
+    task->release += task->period;
+    if ((int32_t)(scheduler_ticks - task->release) >= task->period) // More than one release was missed, don't run it in a burst
+    {
+        task->overruns++;
+        task->release = scheduler_ticks;
+    }
+
+    return 1;
+}
+
+/**
+  * @brief  Run the registered tasks forever
+  * @retval None
+  *
+  * In each pass, the released tasks and every poll task run once. After each task, the search starts again
+  * from the highest priority, so a task released meanwhile runs before the lower priority tasks still waiting.
+  * The tasks are never preempted, so the time a task waits is bounded by the longest run of the others.
+  */
+void dbh_Scheduler_Run(void)
+{
+    while (1)
+    {
+        scheduler_pass++;
+        while (Scheduler_RunNext());
+    }
+}
@@ -0,0 +1,51 @@
+/**
+  ******************************************************************************
+  * @file    scheduler.h
+  * @brief   This file contains the type definitions and function prototypes
+  *          for the scheduler.c file.
+  * @author  doublehan07
+  * @version V1.0
+  * @date    2026-10-17
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SCHEDULER_H
+#define __SCHEDULER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported macro ------------------------------------------------------------*/
+#define SCHEDULER_TASK_MAX        6 // The number of tasks that can be registered
+#define SCHEDULER_POLL            0 // Period of a task that runs once per scheduler pass instead of on a period
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  void (*run)(void);          /*!< Specifies the task function, it must return quickly */
+  uint16_t period;            /*!< Specifies the release period in ms, or SCHEDULER_POLL */
+  uint16_t deadline;          /*!< Specifies the time in ms after its release by which the task must be done */
+  uint8_t priority;           /*!< Specifies the priority, 0 is the highest, released tasks run in priority order */
+  uint32_t release;           /*!< The tick of the next release, or the pass of the last run of a poll task */
+  __IO uint32_t runs;         /*!< The number of runs */
+  __IO uint32_t overruns;     /*!< The number of runs that missed their deadline, and of skipped releases */
+  __IO uint32_t last_cycles;  /*!< The CPU cycles of the last run */
+  __IO uint32_t max_cycles;   /*!< The CPU cycles of the longest run */
+} SCHEDULER_TASK_TypeDef;
+
+/* Exported functions ------------------------------------------------------- */
+SCHEDULER_TASK_TypeDef *dbh_Scheduler_AddTask(void (*run)(void), uint16_t period, uint16_t deadline, uint8_t priority);
+void dbh_Scheduler_Tick(void);
+uint32_t dbh_Scheduler_GetTicks(void);
+void dbh_Scheduler_Run(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SCHEDULER_H */
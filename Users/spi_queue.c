@@ -0,0 +1,275 @@
+/**
+  ******************************************************************************
+  * @file    spi_queue.c
+  * @brief   This file contains the DMA driven transaction queue of SPI1
+  * @author  doublehan07
+  * @version V1.0
+  * @date    2026-10-17
+  ******************************************************************************
+  */
+
+#include "spi_queue.h"
+#include "spi.h"
+#include "delay.h"
+
+// All chip select pins of SPI1 are on the same port, so several devices can be selected with one BSRR write
+#define SPI_QUEUE_CS_PORT         SPI1_CS1_GPIO_Port
+
+SPI_QUEUE_STATS_TypeDef spi_stats = {0};
+
+SPI_TRANSACTION_TypeDef *queue_head = NULL; // The oldest transaction waiting for the bus
+SPI_TRANSACTION_TypeDef *queue_tail = NULL; // The newest transaction waiting for the bus
+SPI_TRANSACTION_TypeDef *active_xfer = NULL; // The transaction on the bus
+__IO uint8_t trigger_pending = 0; // One bit per trigger line
+uint8_t segment_index = 0; // The segment of active_xfer on the bus
+uint8_t segment_offset = 0; // The position of that segment in tx_data/rx_data
+uint32_t segment_end = 0; // The cycle count when the previous segment finished
+
+/**
+  * @brief  Clock one segment of the active transaction through the DMA channels
+  * @retval None
+  *
+  * The DMA channels are reprogrammed directly instead of through HAL_SPI_TransmitReceive_DMA(),
+  * because the ADS1256 commands are 1 to 3 bytes long and the HAL setup would cost more CPU time
+  * than the transfer itself.
+  */
+static void SPIQueue_StartSegment(void)
+{
+    const SPI_SEGMENT_TypeDef *segment = &active_xfer->segments[segment_index];
+    DMA_Channel_TypeDef *rx = hspi1.hdmarx->Instance;
+    DMA_Channel_TypeDef *tx = hspi1.hdmatx->Instance;
+
+    if (segment->delay_us) // Keep CS low and respect the command-to-command delay of the device
+    {
+        while (dbh_GetCycles() - segment_end < segment->delay_us * (SystemCoreClock / 1000000));
+    }
+
+    rx->CCR &= ~DMA_CCR_EN;
+    tx->CCR &= ~DMA_CCR_EN;
+    rx->CMAR = (uint32_t)(active_xfer->rx_data + segment_offset);
+    rx->CNDTR = segment->size;
+    tx->CMAR = (uint32_t)(active_xfer->tx_data + segment_offset);
+    tx->CNDTR = segment->size;
+    rx->CCR |= DMA_CCR_TCIE | DMA_CCR_EN; // Only the RX completion is needed, it implies the last byte is clocked out
+    tx->CCR |= DMA_CCR_EN; // Writing the first byte to the SPI starts the clock
+}
+
+/**
+  * @brief  Put the first transaction that is ready on the bus
+  * @retval None
+  *
+  * A transaction is ready when it has no trigger or its trigger is pending. The queue is searched in order,
+  * so transactions on the same trigger keep their order, while a transaction waiting for its trigger lets
+  * the ready ones behind it pass. Interrupts must be disabled.
+  */
+static void SPIQueue_Start(void)
+{
+    SPI_TRANSACTION_TypeDef *prev = NULL;
+    SPI_TRANSACTION_TypeDef *xfer = queue_head;
+
+    if (active_xfer != NULL)
+    {
+        return;
+    }
+
+    while (xfer != NULL)
+    {
+        if (xfer->trigger == SPI_QUEUE_NO_TRIGGER || (trigger_pending & (1 << xfer->trigger)))
+        {
+            break;
+        }
+        prev = xfer;
+        xfer = xfer->next;
+    }
+
+    if (xfer == NULL)
+    {
+        return; // Nothing is ready, wait for a trigger
+    }
+
+    // Unlink the transaction
+    if (prev == NULL)
+    {
+        queue_head = xfer->next;
+    }
+    else
+    {
+        prev->next = xfer->next;
+    }
+    if (queue_tail == xfer)
+    {
+        queue_tail = prev;
+    }
+
+    active_xfer = xfer;
+    xfer->status = SPI_QUEUE_STATUS_BUSY;
+    segment_index = 0;
+    segment_offset = 0;
+
+    SPI_QUEUE_CS_PORT->BRR = xfer->cs_pins; // Select the devices
+    SPIQueue_StartSegment();
+}
+
+/**
+  * @brief  DMA receive complete callback of SPI1
+  * @param  hdma: DMA handle
+  * @retval None
+  *
+  * This function is called when a segment is fully clocked. It starts the next segment with CS still low,
+  * or releases CS, completes the transaction and starts the next one.
+  */
+static void SPIQueue_RxCplt(DMA_HandleTypeDef *hdma)
+{
+    SPI_TRANSACTION_TypeDef *xfer = active_xfer;
+
+    segment_end = dbh_GetCycles();
+    segment_offset += xfer->segments[segment_index].size;
+    segment_index++;
+
+    if (xfer->segments[segment_index].size) // More segments in this CS frame
+    {
+        SPIQueue_StartSegment();
+        return;
+    }
+
+    SPI_QUEUE_CS_PORT->BSRR = xfer->cs_pins; // Release the devices
+    spi_stats.bytes += segment_offset;
+
+    if (xfer->trigger != SPI_QUEUE_NO_TRIGGER)
+    {
+        trigger_pending &= ~(1 << xfer->trigger); // Edges seen during the transaction are consumed by it
+    }
+
+    active_xfer = NULL;
+    xfer->status = SPI_QUEUE_STATUS_DONE;
+
+    if (xfer->callback != NULL)
+    {
+        xfer->callback(xfer); // May submit new transactions
+    }
+
+    SPIQueue_Start();
+}
+
+/**
+  * @brief  Initialize the SPI transaction queue
+  * @retval None
+  *
+  * This function hands SPI1 and its DMA channels over to the queue. After this call, the blocking
+  * HAL_SPI functions must not be used on hspi1.
+  */
+void dbh_SPIQueue_Init(void)
+{
+    hspi1.hdmarx->Instance->CPAR = (uint32_t)&hspi1.Instance->DR;
+    hspi1.hdmatx->Instance->CPAR = (uint32_t)&hspi1.Instance->DR;
+    hspi1.hdmarx->XferCpltCallback = SPIQueue_RxCplt; // Called by HAL_DMA_IRQHandler()
+
+    SET_BIT(hspi1.Instance->CR2, SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN);
+    __HAL_SPI_ENABLE(&hspi1);
+}
+
+/**
+  * @brief  Add a transaction to the end of the queue
+  * @param  xfer: the transaction, it must stay valid until its status is SPI_QUEUE_STATUS_DONE
+  * @retval None
+  */
+void dbh_SPIQueue_Submit(SPI_TRANSACTION_TypeDef *xfer)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    xfer->next = NULL;
+    xfer->status = SPI_QUEUE_STATUS_QUEUED;
+
+    if (queue_tail == NULL)
+    {
+        queue_head = xfer;
+    }
+    else
+    {
+        queue_tail->next = xfer;
+    }
+    queue_tail = xfer;
+
+    SPIQueue_Start();
+    __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Signal a trigger line, e.g. from a DRDY interrupt
+  * @param  trigger: the trigger line, 0-7
+  * @retval None
+  */
+void dbh_SPIQueue_Trigger(uint8_t trigger)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    trigger_pending |= 1 << trigger;
+    SPIQueue_Start();
+    __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Drop the pending edge of a trigger line
+  * @param  trigger: the trigger line, 0-7
+  * @retval None
+  *
+  * An edge signalled while no transaction waited for it stays pending. This function should be called
+  * before queueing a transaction that must wait for a fresh edge.
+  */
+void dbh_SPIQueue_ClearTrigger(uint8_t trigger)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    trigger_pending &= ~(1 << trigger);
+    __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Wait until a transaction is finished
+  * @param  xfer: the submitted transaction
+  * @retval None
+  */
+void dbh_SPIQueue_Wait(SPI_TRANSACTION_TypeDef *xfer)
+{
+    while (xfer->status != SPI_QUEUE_STATUS_DONE);
+}
+
+/**
+  * @brief  Account CPU time spent in the acquisition interrupts
+  * @param  cycles: the CPU cycles spent in one interrupt
+  * @retval None
+  */
+void dbh_SPIQueue_AddBusyCycles(uint32_t cycles)
+{
+    spi_stats.busy_cycles += cycles;
+}
+
+/**
+  * @brief  Update the throughput and CPU load figures
+  * @param  elapsed: the ms since the last call, a divisor of 1000
+  * @retval None
+  *
+  * This function should be called periodically from the housekeeping task. Once per second, it
+  * snapshots the SPI bytes per second and the share of CPU time not spent in the acquisition interrupts.
+  */
+void dbh_SPIQueue_TickStats(uint16_t elapsed)
+{
+    static uint16_t one_second_cnt = 0;
+    uint32_t busy_percent = 0;
+
+    one_second_cnt += elapsed;
+
+    if (one_second_cnt >= 1000)
+    {
+        busy_percent = spi_stats.busy_cycles / (SystemCoreClock / 100);
+
+        spi_stats.bytes_per_second = spi_stats.bytes;
+        spi_stats.cpu_idle_percent = busy_percent < 100 ? 100 - busy_percent : 0;
+        spi_stats.bytes = 0;
+        spi_stats.busy_cycles = 0;
+        one_second_cnt = 0;
+    }
+}
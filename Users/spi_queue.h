@@ -0,0 +1,74 @@
+/**
+  ******************************************************************************
+  * @file    spi_queue.h
+  * @brief   This file contains the type definitions and function prototypes
+  *          for the spi_queue.c file.
+  * @author  doublehan07
+  * @version V1.0
+  * @date    2026-10-17
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SPI_QUEUE_H
+#define __SPI_QUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported macro ------------------------------------------------------------*/
+#define SPI_QUEUE_NO_TRIGGER      0xFF // The transaction starts as soon as the bus is free
+
+// Transaction status
+#define SPI_QUEUE_STATUS_DONE     0 // Finished, or never submitted
+#define SPI_QUEUE_STATUS_QUEUED   1 // Waiting for the bus or for its trigger
+#define SPI_QUEUE_STATUS_BUSY     2 // On the bus
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint8_t size;     /*!< Specifies the number of bytes clocked in this segment */
+  uint8_t delay_us; /*!< Specifies the minimum pause before this segment, with CS held low */
+} SPI_SEGMENT_TypeDef;
+
+typedef struct SPI_TRANSACTION
+{
+  struct SPI_TRANSACTION *next;                   /*!< Used by the queue, don't touch */
+  const uint8_t *tx_data;                         /*!< Specifies the bytes to send, one per clocked byte */
+  uint8_t *rx_data;                               /*!< Specifies the buffer for the received bytes, same length as tx_data */
+  const SPI_SEGMENT_TypeDef *segments;            /*!< Specifies the segments of the CS frame, terminated by a zero size */
+  void (*callback)(struct SPI_TRANSACTION *xfer); /*!< Called in interrupt context after CS is released, may be NULL */
+  uint16_t cs_pins;                               /*!< Specifies the chip select pins, all on SPI1_CS1_GPIO_Port, driven low together */
+  uint8_t trigger;                                /*!< Specifies the trigger line the transaction waits for, or SPI_QUEUE_NO_TRIGGER */
+  __IO uint8_t status;                            /*!< Specifies the status of the transaction */
+} SPI_TRANSACTION_TypeDef;
+
+typedef struct
+{
+  __IO uint32_t bytes;            /*!< Specifies the bytes clocked since the last snapshot */
+  __IO uint32_t busy_cycles;      /*!< Specifies the CPU cycles spent in the acquisition interrupts since the last snapshot */
+  __IO uint32_t bytes_per_second; /*!< Specifies the SPI throughput of the last second */
+  __IO uint8_t cpu_idle_percent;  /*!< Specifies the CPU time left to the main loop in the last second */
+} SPI_QUEUE_STATS_TypeDef;
+
+/* Exported variables --------------------------------------------------------*/
+extern SPI_QUEUE_STATS_TypeDef spi_stats;
+
+/* Exported functions ------------------------------------------------------- */
+void dbh_SPIQueue_Init(void);
+void dbh_SPIQueue_Submit(SPI_TRANSACTION_TypeDef *xfer);
+void dbh_SPIQueue_Trigger(uint8_t trigger);
+void dbh_SPIQueue_ClearTrigger(uint8_t trigger);
+void dbh_SPIQueue_Wait(SPI_TRANSACTION_TypeDef *xfer);
+void dbh_SPIQueue_AddBusyCycles(uint32_t cycles);
+void dbh_SPIQueue_TickStats(uint16_t elapsed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SPI_QUEUE_H */
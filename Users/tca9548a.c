@@ -11,6 +11,9 @@
 #include "tca9548a.h"
 #include "i2c.h"
 
+__IO uint8_t selected_mask = 0; // The control register content, to skip redundant selects
+__IO uint8_t selected_valid = 0; // The control register content is known
+
 /**
   * @brief  Initialize the TCA9548A I2C multiplexer
   * @retval 1 if successful, 0 if failed
@@ -23,7 +26,15 @@ uint8_t dbh_TCA9548A_Init(void)
     HAL_I2C_Master_Transmit(&hi2c1, TCA9548A_SLAVE_ADDRESS, &tx_data, 1, 1000); // Write the data to the control register
     HAL_I2C_Master_Receive(&hi2c1, TCA9548A_SLAVE_ADDRESS, &rx_data, 1, 1000); // Read the data from the control register
     tx_data = 0x00; // Set the control register to 0x00 to disable all channels
-    HAL_I2C_Master_Transmit(&hi2c1, TCA9548A_SLAVE_ADDRESS, &tx_data, 1, 1000); // Write the data to the control register
+    if (HAL_I2C_Master_Transmit(&hi2c1, TCA9548A_SLAVE_ADDRESS, &tx_data, 1, 1000) == HAL_OK) // Write the data to the control register
+    {
+        selected_mask = tx_data;
+        selected_valid = 1;
+    }
+    else
+    {
+        dbh_TCA9548A_Invalidate(); // Write it again on the next select
+    }
 
     if (rx_data == 0xA4)
     {
@@ -39,19 +50,79 @@ uint8_t dbh_TCA9548A_Init(void)
   * @brief  Select the channel on the TCA9548A I2C multiplexer
   * @param  channel: the channel to select, 0-7
   * @retval None
+  *
+  * The selection is cached, so selecting the channel that is already selected costs no I2C transaction.
+  * All operations on one downstream device can be done behind a single select.
   */
 void dbh_TCA9548A_SelectChannel(uint8_t channel)
 {
-    uint8_t tx_data = 0;
-
     if (channel < 8)
     {
-        tx_data = 1 << channel; // Set the bit corresponding to the channel to 1
+        dbh_TCA9548A_SelectMask(1 << channel); // Set the bit corresponding to the channel to 1
     }
     else
     {
-        tx_data = 0; // Set all bits to 0, disable all channels
+        dbh_TCA9548A_SelectMask(0); // Set all bits to 0, disable all channels
     }
+}
 
-    HAL_I2C_Master_Transmit(&hi2c1, TCA9548A_SLAVE_ADDRESS, &tx_data, 1, 1000); // Write the data to the control register
+/**
+  * @brief  Select several channels on the TCA9548A I2C multiplexer at once
+  * @param  mask: one bit per channel to enable, bit 0 for channel 0
+  * @retval None
+  *
+  * With several channels enabled, devices with the same address on those channels all receive the
+  * following writes, so the same register can be written on all of them in one transaction. Reads
+  * must only be done with a single channel selected. The selection is cached like a single channel.
+  */
+void dbh_TCA9548A_SelectMask(uint8_t mask)
+{
+    uint8_t tx_data = mask;
+
+    if (selected_valid && tx_data == selected_mask)
+    {
+        return; // Already selected
+    }
+
+    if (HAL_I2C_Master_Transmit(&hi2c1, TCA9548A_SLAVE_ADDRESS, &tx_data, 1, 1000) == HAL_OK) // Write the data to the control register
+    {
+        selected_mask = tx_data;
+        selected_valid = 1;
+    }
+    else
+    {
+        selected_valid = 0; // Write it again on the next select
+    }
+}
+
+/**
+  * @brief  Forget the cached selection of the TCA9548A I2C multiplexer
+  * @retval None
+  *
+  * This function should be called when the multiplexer may have been reset, e.g. after an I2C bus recovery.
+  */
+void dbh_TCA9548A_Invalidate(void)
+{
+    selected_valid = 0;
+}
+
+/**
+  * @brief  Check if a set of channels is the current selection of the TCA9548A I2C multiplexer
+  * @param  mask: one bit per channel, bit 0 for channel 0
+  * @retval 1 if exactly these channels are known to be enabled, 0 otherwise
+  */
+uint8_t dbh_TCA9548A_IsSelected(uint8_t mask)
+{
+    return selected_valid && selected_mask == mask;
+}
+
+/**
+  * @brief  Record a selection written outside of this driver, e.g. by the I2C job queue
+  * @param  mask: one bit per channel, bit 0 for channel 0
+  * @retval None
+  */
+void dbh_TCA9548A_SetSelected(uint8_t mask)
+{
+    selected_mask = mask;
+    selected_valid = 1;
 }
@@ -26,6 +26,10 @@ extern "C" {
 /* Exported functions prototypes ---------------------------------------------*/
 uint8_t dbh_TCA9548A_Init(void);
 void dbh_TCA9548A_SelectChannel(uint8_t channel);
+void dbh_TCA9548A_SelectMask(uint8_t mask);
+void dbh_TCA9548A_Invalidate(void);
+uint8_t dbh_TCA9548A_IsSelected(uint8_t mask);
+void dbh_TCA9548A_SetSelected(uint8_t mask);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,413 @@
+/**
+  ******************************************************************************
+  * @file    telemetry.c
+  * @brief   This file contains the functions to pack and send the sensor frames to the host
+  * @author  doublehan07
+  * @version V1.0
+  * @date    2026-10-17
+  ******************************************************************************
+  */
+
+#include "telemetry.h"
+#include "usart.h"
+#include "fsr.h"
+#include "lra_control.h"
+#include "delay.h"
+
+#if ADS1256_CHANNEL_NUM < TELEMETRY_V1_CHANNELS
+#error "The v1 frame needs the channels of two ADS1256"
+#endif
+
+#define TELEMETRY_MAX(a, b)       ((a) > (b) ? (a) : (b))
+
+// The largest frame, in 32-bit words so a v1 frame can be written word by word
+#define TELEMETRY_BUFFER_WORDS    (TELEMETRY_MAX(TELEMETRY_MAX(TELEMETRY_V1_SIZE, TELEMETRY_V2_SAMPLE_SIZE), \
+                                   TELEMETRY_MAX(TELEMETRY_V2_PROFILE_SIZE, TELEMETRY_V2_HOUSEKEEPING_SIZE)) / 4 + 1)
+
+__IO uint8_t telemetry_format = TELEMETRY_FORMAT_V1; // Old hosts only understand v1
+uint32_t tx_buffer[2][TELEMETRY_BUFFER_WORDS] = {0}; // Ping-pong buffers, one on the wire while the other is filled
+__IO uint8_t tx_busy = 0; // A buffer is on the wire
+__IO uint16_t tx_pending_size = 0; // The size of the filled buffer waiting for the wire, 0 if none
+uint8_t fill_index = 0; // The buffer to fill next
+__IO uint32_t tx_overruns = 0; // Frames dropped because both buffers were in use
+__IO uint8_t tx_overrun_flag = 0; // Set when a frame was dropped, cleared when reported in a v2 status byte
+__IO uint8_t ready_status = 0; // The TELEMETRY_STATUS_*_READY bits of the v2 status byte
+__IO uint8_t profile_request = 0; // The host asked for a profile frame
+uint8_t housekeeping_request = 0; // A housekeeping frame is due
+uint32_t last_frame_time = 0; // The dbh_GetMicros() time of the last sample frame
+uint8_t last_frame_valid = 0; // last_frame_time holds a sample frame
+uint32_t tx_start = 0; // The cycle count when the buffer on the wire was started, for the profiler
+
+/**
+  * @brief  Select the wire format of the following frames
+  * @param  format: TELEMETRY_FORMAT_V1 or TELEMETRY_FORMAT_V2, other values are ignored
+  * @retval None
+  */
+void dbh_Telemetry_SetFormat(uint8_t format)
+{
+    if (format == TELEMETRY_FORMAT_V1 || format == TELEMETRY_FORMAT_V2)
+    {
+        telemetry_format = format;
+    }
+}
+
+/**
+  * @brief  Get the wire format of the frames
+  * @retval TELEMETRY_FORMAT_V1 or TELEMETRY_FORMAT_V2
+  */
+uint8_t dbh_Telemetry_GetFormat(void)
+{
+    return telemetry_format;
+}
+
+/**
+  * @brief  Pack a frame in the v1 format
+  * @param  samples: the conversion data of ADS1256_CHANNEL_NUM channels, the first TELEMETRY_V1_CHANNELS are sent
+  * @param  data: the buffer of TELEMETRY_V1_WORDS words to fill
+  * @retval the frame size in bytes
+  */
+static uint16_t Telemetry_PackV1(const int32_t *samples, uint32_t *data)
+{
+    uint8_t i = 0;
+    uint16_t checksum = 0;
+    uint32_t start = 0;
+
+    data[0] = 0x55AA;
+    PROFILER_START(start);
+    data[1] = dbh_FSR_GetADCValue();
+    PROFILER_STOP(PROFILER_STAGE_FSR_ADC, start);
+    for (i = 0; i < TELEMETRY_V1_CHANNELS; i++)
+    {
+        // i = 0 - 7, for the first ADS1256
+        // i = 8 - 15, for the second ADS1256
+        data[i+2] = samples[i];
+        // voltage[i] = (float)data[i] * 5.0 / 0x7FFFFF;
+        // voltage[i] = data[i] * 0.000000596;
+    }
+
+    // Calculate the checksum
+    PROFILER_START(start);
+    for (i = 1; i <= TELEMETRY_V1_CHANNELS + 1; i++)
+    {
+        checksum += data[i];
+    }
+    PROFILER_STOP(PROFILER_STAGE_CHECKSUM, start);
+    data[TELEMETRY_V1_CHANNELS + 2] = (checksum << 16) | dbh_GetTimestamp();
+
+    return TELEMETRY_V1_SIZE;
+}
+
+/**
+  * @brief  Write a 32-bit value in little endian
+  * @param  p: the position in the frame
+  * @param  value: the value to write
+  * @retval the position after the value
+  */
+static uint8_t *Telemetry_Put32(uint8_t *p, uint32_t value)
+{
+    *p++ = value & 0xFF;
+    *p++ = (value >> 8) & 0xFF;
+    *p++ = (value >> 16) & 0xFF;
+    *p++ = value >> 24;
+
+    return p;
+}
+
+/**
+  * @brief  Append the checksum to a v2 frame
+  * @param  frame: the frame, with its header and payload filled
+  * @param  payload: the payload size in bytes
+  * @retval None
+  */
+static void Telemetry_ChecksumV2(uint8_t *frame, uint16_t payload)
+{
+    uint16_t i = 0;
+    uint16_t checksum = 0;
+    uint32_t start = 0;
+
+    // Calculate the checksum from the type byte to the end of the payload
+    PROFILER_START(start);
+    for (i = 2; i < TELEMETRY_V2_HEADER_SIZE + payload; i++)
+    {
+        checksum += frame[i];
+    }
+    PROFILER_STOP(PROFILER_STAGE_CHECKSUM, start);
+
+    frame[i] = checksum & 0xFF;
+    frame[i + 1] = checksum >> 8;
+}
+
+/**
+  * @brief  Pack a sample frame in the v2 format
+  * @param  samples: the conversion data of ADS1256_CHANNEL_NUM channels
+  * @param  frame: the buffer of TELEMETRY_V2_SAMPLE_SIZE bytes to fill
+  * @retval the frame size in bytes
+  *
+  * The ADS1256 data is 24-bit and the VDD in microvolts stays below 2^24, so both are sent in 3 bytes.
+  * The timestamp is the start of the scan on the 32-bit microsecond timebase, see dbh_GetMicros().
+  */
+static uint16_t Telemetry_PackV2(const int32_t *samples, uint8_t *frame)
+{
+    uint8_t i = 0;
+    uint8_t *p = frame;
+    uint32_t vdd = 0;
+    uint32_t start = 0;
+    const ADS1256_FRAME_INFO_TypeDef *info = dbh_ADS1256_GetFrameInfo();
+
+    PROFILER_START(start);
+    vdd = dbh_FSR_GetADCValue();
+    PROFILER_STOP(PROFILER_STAGE_FSR_ADC, start);
+
+    *p++ = TELEMETRY_V2_SYNC0;
+    *p++ = TELEMETRY_V2_SYNC1;
+    *p++ = TELEMETRY_TYPE_SAMPLE;
+    *p++ = TELEMETRY_V2_SAMPLE_PAYLOAD;
+
+    *p++ = (tx_overrun_flag ? TELEMETRY_STATUS_TX_OVERRUN : 0x00) | (info->late ? TELEMETRY_STATUS_LATE_FRAME : 0x00) | ready_status; // Status
+    tx_overrun_flag = 0;
+
+    *p++ = vdd & 0xFF;
+    *p++ = (vdd >> 8) & 0xFF;
+    *p++ = (vdd >> 16) & 0xFF;
+
+    for (i = 0; i < ADS1256_CHANNEL_NUM; i++)
+    {
+        *p++ = samples[i] & 0xFF;
+        *p++ = (samples[i] >> 8) & 0xFF;
+        *p++ = (samples[i] >> 16) & 0xFF;
+    }
+
+    *p++ = info->sequence & 0xFF;
+    *p++ = info->sequence >> 8;
+
+    Telemetry_Put32(p, info->timestamp);
+
+    Telemetry_ChecksumV2(frame, TELEMETRY_V2_SAMPLE_PAYLOAD);
+
+    return TELEMETRY_V2_SAMPLE_SIZE;
+}
+
+/**
+  * @brief  Pack the profiler statistics in a v2 frame and start a new measurement window
+  * @param  frame: the buffer of TELEMETRY_V2_PROFILE_SIZE bytes to fill
+  * @retval the frame size in bytes
+  */
+static uint16_t Telemetry_PackProfile(uint8_t *frame)
+{
+    uint8_t i = 0;
+    uint8_t *p = frame;
+    PROFILER_STAGE_TypeDef stats = {0};
+
+    *p++ = TELEMETRY_V2_SYNC0;
+    *p++ = TELEMETRY_V2_SYNC1;
+    *p++ = TELEMETRY_TYPE_PROFILE;
+    *p++ = TELEMETRY_V2_PROFILE_PAYLOAD;
+
+    *p++ = PROFILER_STAGE_NUM;
+    for (i = 0; i < PROFILER_STAGE_NUM; i++)
+    {
+        dbh_Profiler_Fetch(i, &stats);
+        p = Telemetry_Put32(p, stats.count);
+        p = Telemetry_Put32(p, stats.count ? stats.min : 0);
+        p = Telemetry_Put32(p, stats.count ? (uint32_t)(stats.sum / stats.count) : 0);
+        p = Telemetry_Put32(p, stats.max);
+    }
+
+    Telemetry_ChecksumV2(frame, TELEMETRY_V2_PROFILE_PAYLOAD);
+
+    return TELEMETRY_V2_PROFILE_SIZE;
+}
+
+/**
+  * @brief  Pack the timing histograms in a v2 frame and start a new window
+  * @param  frame: the buffer of TELEMETRY_V2_HOUSEKEEPING_SIZE bytes to fill
+  * @retval the frame size in bytes
+  */
+static uint16_t Telemetry_PackHousekeeping(uint8_t *frame)
+{
+    uint8_t i = 0;
+    uint8_t j = 0;
+    uint8_t *p = frame;
+    HISTOGRAM_TypeDef histogram = {0};
+
+    *p++ = TELEMETRY_V2_SYNC0;
+    *p++ = TELEMETRY_V2_SYNC1;
+    *p++ = TELEMETRY_TYPE_HOUSEKEEPING;
+    *p++ = TELEMETRY_V2_HOUSEKEEPING_PAYLOAD;
+
+    *p++ = HISTOGRAM_BINS;
+    for (i = 0; i < HISTOGRAM_NUM; i++)
+    {
+        dbh_Histogram_Fetch(i, &histogram);
+        for (j = 0; j < HISTOGRAM_BINS; j++)
+        {
+            *p++ = histogram.bins[j] & 0xFF;
+            *p++ = histogram.bins[j] >> 8;
+        }
+    }
+
+    Telemetry_ChecksumV2(frame, TELEMETRY_V2_HOUSEKEEPING_PAYLOAD);
+
+    return TELEMETRY_V2_HOUSEKEEPING_SIZE;
+}
+
+/**
+  * @brief  Put the filled buffer on the wire, or leave it to the TX complete callback
+  * @param  size: the frame size in bytes
+  * @retval None
+  */
+static void Telemetry_Transmit(uint16_t size)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq(); // The TX complete callback must not run between the check and the update
+    if (!tx_busy)
+    {
+        tx_busy = 1;
+        PROFILER_START(tx_start);
+        HAL_UART_Transmit_DMA(&huart1, (uint8_t *)tx_buffer[fill_index], size); // Send the data over UART
+    }
+    else
+    {
+        tx_pending_size = size; // Sent by the TX complete callback
+    }
+    fill_index ^= 1;
+    __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Pack a frame of the ADS1256 channels and send it to the host
+  * @param  samples: the conversion data of ADS1256_CHANNEL_NUM channels
+  * @retval None
+  *
+  * The frame is packed into the free ping-pong buffer and sent by the DMA, so this function never waits
+  * for the UART. If one buffer is on the wire and the other is still waiting for it, the frame is dropped
+  * and counted in tx_overruns. A requested profile frame, or else a due housekeeping frame, follows in
+  * the other buffer if it is free.
+  */
+void dbh_Telemetry_SendFrame(const int32_t *samples)
+{
+    uint16_t size = 0;
+    uint32_t now = dbh_GetMicros();
+
+    if (last_frame_valid)
+    {
+        dbh_Histogram_Add(HISTOGRAM_FRAME_INTERVAL, now - last_frame_time);
+    }
+    last_frame_time = now;
+    last_frame_valid = 1;
+
+    if (tx_pending_size) // Both buffers are in use
+    {
+        tx_overruns++;
+        tx_overrun_flag = 1;
+        return;
+    }
+
+    if (telemetry_format == TELEMETRY_FORMAT_V2)
+    {
+        size = Telemetry_PackV2(samples, (uint8_t *)tx_buffer[fill_index]);
+    }
+    else
+    {
+        size = Telemetry_PackV1(samples, tx_buffer[fill_index]);
+    }
+    Telemetry_Transmit(size);
+
+    if (tx_pending_size)
+    {
+        return; // No free buffer, try again with the next frame
+    }
+
+    if (profile_request)
+    {
+        profile_request = 0;
+        Telemetry_Transmit(Telemetry_PackProfile((uint8_t *)tx_buffer[fill_index]));
+    }
+    else if (housekeeping_request && telemetry_format == TELEMETRY_FORMAT_V2)
+    {
+        housekeeping_request = 0;
+        Telemetry_Transmit(Telemetry_PackHousekeeping((uint8_t *)tx_buffer[fill_index]));
+    }
+}
+
+/**
+  * @brief  Get the number of frames dropped because the UART could not keep up
+  * @retval the number of dropped frames since power up
+  */
+uint32_t dbh_Telemetry_GetOverruns(void)
+{
+    return tx_overruns;
+}
+
+/**
+  * @brief  Report which subsystems are up in the v2 status byte
+  * @param  ready: TELEMETRY_STATUS_SENSORS_READY, TELEMETRY_STATUS_HAPTICS_CALIBRATING and TELEMETRY_STATUS_HAPTICS_READY bits
+  * @retval None
+  */
+void dbh_Telemetry_SetReady(uint8_t ready)
+{
+    ready_status = ready & TELEMETRY_STATUS_READY_MASK;
+}
+
+/**
+  * @brief  Ask for a profile frame, see TELEMETRY_TYPE_PROFILE
+  * @retval None
+  *
+  * The frame is sent after the next sample frame, in the v2 layout whatever the selected format. At
+  * high frame rates it may take the place of the following sample frame, which shows as a gap in the
+  * sequence numbers.
+  */
+void dbh_Telemetry_RequestProfile(void)
+{
+    profile_request = 1;
+}
+
+/**
+  * @brief  Schedule the periodic housekeeping frame, see TELEMETRY_TYPE_HOUSEKEEPING
+  * @param  elapsed: the ms since the last call
+  * @retval None
+  *
+  * This function should be called periodically from the housekeeping task. Every
+  * TELEMETRY_HOUSEKEEPING_PERIOD, the frame interval and command latency histograms are sent after the
+  * next sample frame. v1 hosts don't know the frame, so it is held back until the host selects v2.
+  */
+void dbh_Telemetry_TickHousekeeping(uint16_t elapsed)
+{
+    static uint16_t housekeeping_cnt = 0;
+
+    housekeeping_cnt += elapsed;
+
+    if (housekeeping_cnt >= TELEMETRY_HOUSEKEEPING_PERIOD)
+    {
+        housekeeping_request = 1;
+        housekeeping_cnt = 0;
+    }
+}
+
+/**
+  * @brief  UART transmit complete callback
+  * @param  huart: UART handle
+  * @retval None
+  *
+  * This function is called when a buffer is fully sent. It puts the waiting buffer, if any, on the wire.
+  */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if (huart->Instance == USART1)
+    {
+        PROFILER_STOP(PROFILER_STAGE_UART_TX, tx_start);
+
+        if (tx_pending_size)
+        {
+            PROFILER_START(tx_start);
+            // fill_index was toggled past the waiting buffer, so the waiting one is the other buffer
+            HAL_UART_Transmit_DMA(&huart1, (uint8_t *)tx_buffer[fill_index ^ 1], tx_pending_size);
+            tx_pending_size = 0;
+        }
+        else
+        {
+            tx_busy = 0;
+        }
+    }
+}
@@ -0,0 +1,76 @@
+/**
+  ******************************************************************************
+  * @file    telemetry.h
+  * @brief   This file contains the frame formats and function prototypes
+  *          for the telemetry.c file.
+  * @author  doublehan07
+  * @version V1.0
+  * @date    2026-10-17
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TELEMETRY_H
+#define __TELEMETRY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "ads1256.h"
+#include "profiler.h"
+#include "histogram.h"
+
+/* Exported macro ------------------------------------------------------------*/
+// Wire formats, selected at runtime by the host
+#define TELEMETRY_FORMAT_V1       1 // 32-bit words: 0x55AA | FSR | channels | checksum << 16 | timestamp
+#define TELEMETRY_FORMAT_V2       2 // Packed bytes: 0xAA 0x55 | type | length | payload | checksum
+
+// v1 frame: header, FSR, ADS1256 channels, checksum and timestamp, all 32-bit little endian
+// The v1 frame always carries the channels of the first two devices, the third one is only sent in v2
+#define TELEMETRY_V1_CHANNELS     16
+#define TELEMETRY_V1_WORDS        (TELEMETRY_V1_CHANNELS + 3)
+#define TELEMETRY_V1_SIZE         (TELEMETRY_V1_WORDS * 4)
+
+// v2 frame, all fields little endian
+// Sync (0xAA 0x55) | Type | Length | Payload (Length bytes) | Checksum (16-bit sum of Type to the end of Payload)
+#define TELEMETRY_V2_SYNC0        0xAA // The same first bytes as a v1 frame, which is followed by 0x00 0x00 instead of a type
+#define TELEMETRY_V2_SYNC1        0x55
+#define TELEMETRY_V2_VERSION      0x20 // High nibble of the type byte
+#define TELEMETRY_TYPE_SAMPLE     (TELEMETRY_V2_VERSION | 0x02) // Status | VDD (24-bit, uV) | channels (24-bit signed) | sequence (16-bit) | timestamp (32-bit, us)
+#define TELEMETRY_TYPE_PROFILE    (TELEMETRY_V2_VERSION | 0x03) // Stage count | per stage: count, min, mean, max (32-bit, CPU cycles)
+#define TELEMETRY_TYPE_HOUSEKEEPING (TELEMETRY_V2_VERSION | 0x04) // Bin count | frame interval bins | command latency bins (16-bit counts)
+#define TELEMETRY_V2_HEADER_SIZE  4
+
+// v2 status byte
+#define TELEMETRY_STATUS_TX_OVERRUN 0x01 // Frames were dropped since the last frame, see dbh_Telemetry_GetOverruns()
+#define TELEMETRY_STATUS_SENSORS_READY 0x02 // The ADS1256 scan and the VDD measurement are running
+#define TELEMETRY_STATUS_HAPTICS_CALIBRATING 0x04 // The DRV2605L bring-up is running, haptic commands are held back
+#define TELEMETRY_STATUS_HAPTICS_READY 0x08 // The DRV2605L bring-up is done, haptic commands are executed
+#define TELEMETRY_STATUS_LATE_FRAME 0x10 // The scan of this frame overran the frame period, see dbh_ADS1256_SetFramePeriod()
+#define TELEMETRY_STATUS_READY_MASK (TELEMETRY_STATUS_SENSORS_READY | TELEMETRY_STATUS_HAPTICS_CALIBRATING | TELEMETRY_STATUS_HAPTICS_READY)
+#define TELEMETRY_V2_SAMPLE_PAYLOAD (1 + 3 + ADS1256_CHANNEL_NUM * 3 + 2 + 4)
+#define TELEMETRY_V2_SAMPLE_SIZE  (TELEMETRY_V2_HEADER_SIZE + TELEMETRY_V2_SAMPLE_PAYLOAD + 2)
+#define TELEMETRY_V2_PROFILE_PAYLOAD (1 + PROFILER_STAGE_NUM * 16)
+#define TELEMETRY_V2_PROFILE_SIZE (TELEMETRY_V2_HEADER_SIZE + TELEMETRY_V2_PROFILE_PAYLOAD + 2)
+#define TELEMETRY_V2_HOUSEKEEPING_PAYLOAD (1 + HISTOGRAM_NUM * HISTOGRAM_BINS * 2)
+#define TELEMETRY_V2_HOUSEKEEPING_SIZE (TELEMETRY_V2_HEADER_SIZE + TELEMETRY_V2_HOUSEKEEPING_PAYLOAD + 2)
+
+#define TELEMETRY_HOUSEKEEPING_PERIOD 1000 // The ms between two housekeeping frames
+
+/* Exported functions ------------------------------------------------------- */
+void dbh_Telemetry_SetFormat(uint8_t format);
+uint8_t dbh_Telemetry_GetFormat(void);
+void dbh_Telemetry_SendFrame(const int32_t *samples);
+uint32_t dbh_Telemetry_GetOverruns(void);
+void dbh_Telemetry_SetReady(uint8_t ready);
+void dbh_Telemetry_RequestProfile(void);
+void dbh_Telemetry_TickHousekeeping(uint16_t elapsed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TELEMETRY_H */